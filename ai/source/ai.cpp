@@ -7,7 +7,7 @@ namespace ai
 {
 	value_type random_real_value() noexcept
 	{
-		static std::mt19937 generator(std::random_device{}());
+		thread_local std::mt19937 generator(std::random_device{}());
 		return std::uniform_real_distribution<value_type>(value_type(-1.0), value_type(+1.0))(generator);
 	}
 
@@ -24,6 +24,41 @@ namespace ai
 		return std::transform_reduce(std::execution::unseq, std::begin(a), std::end(a), std::begin(b), value_type());
 	}
 
+	array_type& multiply(const array_type& matrix, const array_type& vector, array_type& result) noexcept
+	{
+		const auto columns = vector.size();
+		for (size_t row = 0; row != result.size(); row++)
+		{
+			const auto begin = std::begin(matrix) + row * columns;
+			result[row] = std::transform_reduce(std::execution::unseq, begin, begin + columns, std::begin(vector), value_type());
+		}
+		return result;
+	}
+
+	array_type& multiply_transposed(const array_type& matrix, const array_type& vector, array_type& result) noexcept
+	{
+		const auto columns = result.size();
+		result = value_type();
+		for (size_t row = 0; row != vector.size(); row++)
+		{
+			const auto begin = std::begin(matrix) + row * columns;
+			std::transform(std::execution::unseq, begin, begin + columns, std::begin(result), std::begin(result), [&](auto weight, auto value) {
+				return value + weight * vector[row];
+			});
+		}
+		return result;
+	}
+
+	array_type& softmax(array_type& array) noexcept
+	{
+		if (array.size())
+		{
+			array = std::exp(array - array.max());
+			array /= array.sum();
+		}
+		return array;
+	}
+
 
 	value_type sigmoid::activation(value_type x) const noexcept
 	{
@@ -11,6 +11,9 @@ namespace ai
 	value_type random_real_value() noexcept;
 	array_type& random_real_array(array_type& array) noexcept;
 	value_type dot(const array_type& a, const array_type& b) noexcept;
+	array_type& multiply(const array_type& matrix, const array_type& vector, array_type& result) noexcept;
+	array_type& multiply_transposed(const array_type& matrix, const array_type& vector, array_type& result) noexcept;
+	array_type& softmax(array_type& array) noexcept;
 
 	class base_activation
 	{
@@ -0,0 +1,286 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <cmath>
+#include "main.hpp"
+
+namespace ai
+{
+	class kv_cache
+	{
+	private:
+		size_t _size, _length;
+		std::vector<value_type> _keys, _values;
+	public:
+		explicit kv_cache(size_t size = 1, size_t capacity = 0) : _size(size), _length(0)
+		{
+			this->reserve(capacity);
+		}
+
+		void reserve(size_t capacity)
+		{
+			this->_keys.reserve(capacity * this->_size);
+			this->_values.reserve(capacity * this->_size);
+		}
+
+		void append(const array_type& key, const array_type& value)
+		{
+			if (key.size() != this->_size || value.size() != this->_size)
+			{
+				throw std::invalid_argument("invalid size");
+			}
+			this->_keys.insert(this->_keys.end(), std::begin(key), std::end(key));
+			this->_values.insert(this->_values.end(), std::begin(value), std::end(value));
+			this->_length++;
+		}
+
+		std::span<const value_type> key(size_t index) const noexcept
+		{
+			return { this->_keys.data() + index * this->_size, this->_size };
+		}
+
+		std::span<const value_type> value(size_t index) const noexcept
+		{
+			return { this->_values.data() + index * this->_size, this->_size };
+		}
+
+		void clear() noexcept
+		{
+			this->_keys.clear();
+			this->_values.clear();
+			this->_length = 0;
+		}
+
+		size_t size() const noexcept
+		{
+			return this->_size;
+		}
+
+		size_t length() const noexcept
+		{
+			return this->_length;
+		}
+
+		size_t capacity() const noexcept
+		{
+			return this->_keys.capacity() / this->_size;
+		}
+	};
+
+	class kv_cache_pool
+	{
+	private:
+		struct _state
+		{
+			const size_t size, capacity;
+			std::mutex mutex;
+			std::vector<std::unique_ptr<kv_cache>> caches;
+			size_t created = 0;
+		};
+
+		struct _release
+		{
+			std::weak_ptr<_state> state;
+
+			void operator()(kv_cache* pointer) const noexcept
+			{
+				std::unique_ptr<kv_cache> cache(pointer);
+				if (const auto owner = state.lock())
+				{
+					cache->clear();
+					std::lock_guard lock(owner->mutex);
+					owner->caches.push_back(std::move(cache));
+				}
+			}
+		};
+	public:
+		using handle_type = std::unique_ptr<kv_cache, _release>;
+	private:
+		std::shared_ptr<_state> _shared;
+	public:
+		explicit kv_cache_pool(size_t size, size_t capacity = 0) : _shared(std::make_shared<_state>(size, capacity))
+		{
+		}
+
+		kv_cache_pool(const kv_cache_pool&) = delete;
+		kv_cache_pool& operator=(const kv_cache_pool&) = delete;
+
+		handle_type acquire()
+		{
+			auto& state = *this->_shared;
+			std::unique_ptr<kv_cache> cache;
+			{
+				std::lock_guard lock(state.mutex);
+				if (!state.caches.empty())
+				{
+					cache = std::move(state.caches.back());
+					state.caches.pop_back();
+				}
+				else
+				{
+					state.caches.reserve(state.created + 1);
+					state.created++;
+				}
+			}
+			if (!cache)
+			{
+				try
+				{
+					cache = std::make_unique<kv_cache>(state.size, state.capacity);
+				}
+				catch (...)
+				{
+					std::lock_guard lock(state.mutex);
+					state.created--;
+					throw;
+				}
+			}
+			return handle_type(cache.release(), _release{ this->_shared });
+		}
+
+		size_t size() const noexcept
+		{
+			return this->_shared->size;
+		}
+	};
+
+	class attention_layer : public base_layer
+	{
+	private:
+		const size_t _input_size, _size;
+		array_type _query, _key, _value, _output;
+		std::vector<adam_optimizer> _query_optimizer, _key_optimizer, _value_optimizer, _output_optimizer;
+		kv_cache _cache;
+		array_type _query_state, _key_state, _value_state, _scores, _context;
+	public:
+		explicit attention_layer(size_t input_size = 1, size_t output_size = 1) : _input_size(input_size), _size(output_size),
+			_query(input_size * output_size), _key(input_size * output_size), _value(input_size * output_size), _output(output_size * output_size),
+			_query_optimizer(input_size * output_size), _key_optimizer(input_size * output_size), _value_optimizer(input_size * output_size), _output_optimizer(output_size * output_size),
+			_cache(output_size), _query_state(output_size), _key_state(output_size), _value_state(output_size), _context(output_size)
+		{
+			const auto scale = 1 / std::sqrt(value_type(input_size));
+			random_real_array(this->_query) *= scale;
+			random_real_array(this->_key) *= scale;
+			random_real_array(this->_value) *= scale;
+			random_real_array(this->_output) *= 1 / std::sqrt(value_type(output_size));
+		}
+
+		attention_layer(const attention_layer&) = delete;
+		attention_layer& operator=(const attention_layer&) = delete;
+
+		array_type predict(const array_type& inputs) override
+		{
+			return this->predict(inputs, this->_cache);
+		}
+
+		array_type predict(const array_type& inputs, kv_cache& cache)
+		{
+			if (inputs.size() != this->_input_size || cache.size() != this->_size)
+			{
+				throw std::invalid_argument("invalid size");
+			}
+			multiply(this->_query, inputs, this->_query_state);
+			multiply(this->_key, inputs, this->_key_state);
+			multiply(this->_value, inputs, this->_value_state);
+			cache.append(this->_key_state, this->_value_state);
+
+			const auto scale = 1 / std::sqrt(value_type(this->_size));
+			this->_scores.resize(cache.length());
+			for (size_t i = 0; i != cache.length(); i++)
+			{
+				const auto key = cache.key(i);
+				this->_scores[i] = scale * std::transform_reduce(std::execution::unseq, key.begin(), key.end(), std::begin(this->_query_state), value_type());
+			}
+			softmax(this->_scores);
+
+			this->_context = value_type();
+			for (size_t i = 0; i != cache.length(); i++)
+			{
+				const auto value = cache.value(i);
+				const auto score = this->_scores[i];
+				std::transform(std::execution::unseq, value.begin(), value.end(), std::begin(this->_context), std::begin(this->_context), [&](auto element, auto context) {
+					return context + score * element;
+				});
+			}
+
+			array_type outputs(this->_size);
+			return multiply(this->_output, this->_context, outputs);
+		}
+
+		array_type update(const array_type& inputs, const array_type& gradients) override
+		{
+			return this->update(inputs, gradients, this->_cache);
+		}
+
+		array_type update(const array_type& inputs, const array_type& gradients, const kv_cache& cache)
+		{
+			if (cache.size() != this->_size || cache.length() == 0 || cache.length() != this->_scores.size())
+			{
+				throw std::logic_error("update without predict");
+			}
+			const auto scale = 1 / std::sqrt(value_type(this->_size));
+
+			array_type context_gradients(this->_size);
+			multiply_transposed(this->_output, gradients, context_gradients);
+			_update(this->_output, this->_output_optimizer, gradients, this->_context);
+
+			const auto context_projection = dot(context_gradients, this->_context);
+			array_type query_gradients(value_type(), this->_size);
+			value_type last_score_gradient = 0;
+			for (size_t i = 0; i != cache.length(); i++)
+			{
+				const auto value = cache.value(i), key = cache.key(i);
+				const auto value_projection = std::transform_reduce(std::execution::unseq, value.begin(), value.end(), std::begin(context_gradients), value_type());
+				const auto score_gradient = this->_scores[i] * (value_projection - context_projection) * scale;
+				std::transform(std::execution::unseq, key.begin(), key.end(), std::begin(query_gradients), std::begin(query_gradients), [&](auto element, auto gradient) {
+					return gradient + score_gradient * element;
+				});
+				last_score_gradient = score_gradient;
+			}
+			const array_type key_gradients = last_score_gradient * this->_query_state;
+			const array_type value_gradients = this->_scores[this->_scores.size() - 1] * context_gradients;
+
+			array_type result(value_type(), this->_input_size), temp(this->_input_size);
+			result += multiply_transposed(this->_query, query_gradients, temp);
+			result += multiply_transposed(this->_key, key_gradients, temp);
+			result += multiply_transposed(this->_value, value_gradients, temp);
+
+			_update(this->_query, this->_query_optimizer, query_gradients, inputs);
+			_update(this->_key, this->_key_optimizer, key_gradients, inputs);
+			_update(this->_value, this->_value_optimizer, value_gradients, inputs);
+			return result;
+		}
+
+		void reset() noexcept
+		{
+			this->_cache.clear();
+			this->_scores.resize(0);
+		}
+
+		size_t input_size() const noexcept override
+		{
+			return this->_input_size;
+		}
+
+		size_t output_size() const noexcept override
+		{
+			return this->_size;
+		}
+	private:
+		static void _update(array_type& matrix, std::vector<adam_optimizer>& optimizers, const array_type& gradients, const array_type& inputs) noexcept
+		{
+			const auto columns = inputs.size();
+			for (size_t row = 0; row != gradients.size(); row++)
+			{
+				for (size_t column = 0; column != columns; column++)
+				{
+					const auto index = row * columns + column;
+					optimizers[index].update(matrix[index], gradients[row] * inputs[column]);
+				}
+			}
+		}
+	};
+}
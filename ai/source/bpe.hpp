@@ -0,0 +1,287 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <cstdint>
+#include "tokenizer.hpp"
+
+class bpe_tokenizer
+{
+public:
+	using id_type = string_tokenizer::id_type;
+	using pair_type = std::pair<id_type, id_type>;
+	static constexpr size_t alphabet_size = 256;
+private:
+	struct _rank
+	{
+		size_t rank;
+		id_type id;
+	};
+
+	struct _pair_entry
+	{
+		std::uint64_t key;
+		std::int64_t count;
+		size_t position;
+		std::vector<std::uint32_t> words;
+	};
+
+	class _pair_queue
+	{
+	private:
+		std::vector<_pair_entry> _entries;
+		std::unordered_map<std::uint64_t, size_t> _index;
+		std::vector<size_t> _heap;
+	public:
+		void add(std::uint64_t key, std::int64_t delta, std::uint32_t word)
+		{
+			auto [iterator, inserted] = this->_index.try_emplace(key, this->_entries.size());
+			if (inserted)
+			{
+				this->_entries.push_back({ key, 0, this->_heap.size(), {} });
+				this->_heap.push_back(iterator->second);
+			}
+			auto& entry = this->_entries[iterator->second];
+			entry.count += delta;
+			if (delta > 0)
+			{
+				entry.words.push_back(word);
+				this->_sift_up(entry.position);
+			}
+			else
+			{
+				this->_sift_down(entry.position);
+			}
+		}
+
+		_pair_entry* top() noexcept
+		{
+			return this->_heap.empty() ? nullptr : &this->_entries[this->_heap.front()];
+		}
+	private:
+		bool _less(size_t a, size_t b) const noexcept
+		{
+			const auto& left = this->_entries[this->_heap[a]];
+			const auto& right = this->_entries[this->_heap[b]];
+			return (left.count != right.count) ? left.count < right.count : left.key > right.key;
+		}
+
+		void _swap(size_t a, size_t b) noexcept
+		{
+			std::swap(this->_heap[a], this->_heap[b]);
+			this->_entries[this->_heap[a]].position = a;
+			this->_entries[this->_heap[b]].position = b;
+		}
+
+		void _sift_up(size_t position) noexcept
+		{
+			while (position && this->_less((position - 1) / 2, position))
+			{
+				this->_swap((position - 1) / 2, position);
+				position = (position - 1) / 2;
+			}
+		}
+
+		void _sift_down(size_t position) noexcept
+		{
+			while (true)
+			{
+				auto largest = position;
+				for (const auto child : { 2 * position + 1, 2 * position + 2 })
+				{
+					if (child < this->_heap.size() && this->_less(largest, child))
+					{
+						largest = child;
+					}
+				}
+				if (largest == position)
+				{
+					break;
+				}
+				this->_swap(largest, position);
+				position = largest;
+			}
+		}
+	};
+private:
+	string_tokenizer _vocabulary;
+	std::vector<pair_type> _merges;
+	std::unordered_map<std::uint64_t, _rank> _ranks;
+public:
+	bpe_tokenizer()
+	{
+		this->_vocabulary.reserve(alphabet_size);
+		for (size_t i = 0; i != alphabet_size; i++)
+		{
+			const char value = (char)i;
+			this->_vocabulary.insert(std::string_view(&value, 1));
+		}
+	}
+
+	void train(std::string_view corpus, size_t vocabulary_size, size_t min_frequency = 2)
+	{
+		string_tokenizer words;
+		std::vector<std::int64_t> frequencies;
+		string_tokenizer::for_each_token(corpus, [&](std::string_view token) {
+			const auto id = words.insert(token);
+			if (id == frequencies.size()) frequencies.push_back(0);
+			frequencies[id]++;
+		});
+
+		std::vector<std::vector<id_type>> symbols(words.size());
+		for (id_type word = 0; word != words.size(); word++)
+		{
+			symbols[word] = this->_split(words.find_one(word));
+		}
+
+		std::vector<std::pair<std::uint64_t, std::int64_t>> deltas;
+		_pair_queue queue;
+		for (std::uint32_t word = 0; word != symbols.size(); word++)
+		{
+			_pair_deltas(symbols[word], frequencies[word], deltas);
+			for (const auto& [key, delta] : deltas) queue.add(key, delta, word);
+			deltas.clear();
+		}
+
+		while (this->size() < vocabulary_size)
+		{
+			auto entry = queue.top();
+			if (!entry || entry->count < (std::int64_t)std::max<size_t>(min_frequency, 1))
+			{
+				break;
+			}
+			const auto key = entry->key;
+			const auto pair = _unpack(key);
+			auto affected = std::move(entry->words);
+			std::sort(affected.begin(), affected.end());
+			affected.erase(std::unique(affected.begin(), affected.end()), affected.end());
+
+			const auto id = this->_add_merge(pair);
+			for (const auto word : affected)
+			{
+				auto& word_symbols = symbols[word];
+				_pair_deltas(word_symbols, -frequencies[word], deltas);
+				_merge(word_symbols, pair, id);
+				_pair_deltas(word_symbols, frequencies[word], deltas);
+				std::sort(deltas.begin(), deltas.end());
+				for (size_t begin = 0, end = 0; begin != deltas.size(); begin = end)
+				{
+					std::int64_t delta = 0;
+					for (end = begin; end != deltas.size() && deltas[end].first == deltas[begin].first; end++) delta += deltas[end].second;
+					if (delta)
+					{
+						queue.add(deltas[begin].first, delta, word);
+					}
+				}
+				deltas.clear();
+			}
+		}
+	}
+
+	std::vector<id_type> encode(std::string_view input) const
+	{
+		std::vector<id_type> result;
+		string_tokenizer::for_each_token(input, [&](std::string_view token) {
+			auto word = this->_split(token);
+			while (word.size() > 1)
+			{
+				const _rank* best = nullptr;
+				pair_type best_pair;
+				for (size_t i = 0; i + 1 < word.size(); i++)
+				{
+					const auto iterator = this->_ranks.find(_pack(word[i], word[i + 1]));
+					if (iterator != this->_ranks.end() && (!best || iterator->second.rank < best->rank))
+					{
+						best = &iterator->second;
+						best_pair = { word[i], word[i + 1] };
+					}
+				}
+				if (!best)
+				{
+					break;
+				}
+				_merge(word, best_pair, best->id);
+			}
+			result.insert(result.end(), word.begin(), word.end());
+		});
+		return result;
+	}
+
+	std::string decode(const std::vector<id_type>& ids) const
+	{
+		return this->_vocabulary.find_all(ids);
+	}
+
+	const string_tokenizer& vocabulary() const noexcept
+	{
+		return this->_vocabulary;
+	}
+
+	const std::vector<pair_type>& merges() const noexcept
+	{
+		return this->_merges;
+	}
+
+	size_t size() const noexcept
+	{
+		return this->_vocabulary.size();
+	}
+private:
+	id_type _add_merge(const pair_type& pair)
+	{
+		std::string token(this->_vocabulary.find_one(pair.first));
+		token += this->_vocabulary.find_one(pair.second);
+		const auto id = this->_vocabulary.insert(token);
+		this->_ranks.emplace(_pack(pair.first, pair.second), _rank{ this->_merges.size(), id });
+		this->_merges.push_back(pair);
+		return id;
+	}
+
+	static std::vector<id_type> _split(std::string_view token)
+	{
+		std::vector<id_type> result(token.size());
+		std::transform(token.begin(), token.end(), result.begin(), [](char value) {
+			return (id_type)(unsigned char)value;
+		});
+		return result;
+	}
+
+	static void _merge(std::vector<id_type>& word, const pair_type& pair, id_type id) noexcept
+	{
+		size_t output = 0;
+		for (size_t input = 0; input != word.size(); input++)
+		{
+			if (input + 1 < word.size() && word[input] == pair.first && word[input + 1] == pair.second)
+			{
+				word[output++] = id;
+				input++;
+			}
+			else
+			{
+				word[output++] = word[input];
+			}
+		}
+		word.resize(output);
+	}
+
+	static void _pair_deltas(const std::vector<id_type>& word, std::int64_t frequency, std::vector<std::pair<std::uint64_t, std::int64_t>>& deltas)
+	{
+		for (size_t i = 0; i + 1 < word.size(); i++)
+		{
+			deltas.emplace_back(_pack(word[i], word[i + 1]), frequency);
+		}
+	}
+
+	static constexpr std::uint64_t _pack(id_type first, id_type second) noexcept
+	{
+		return (std::uint64_t(first) << 32) | second;
+	}
+
+	static constexpr pair_type _unpack(std::uint64_t key) noexcept
+	{
+		return { id_type(key >> 32), id_type(key) };
+	}
+};
@@ -0,0 +1,113 @@
+#pragma once
+
+#include <string_view>
+#include <vector>
+#include <thread>
+#include <atomic>
+#include <algorithm>
+#include <filesystem>
+#include "tokenizer.hpp"
+#include "mapped_file.hpp"
+
+struct corpus_vocabulary
+{
+	string_tokenizer tokens;
+	std::vector<size_t> counts;
+
+	void add(std::string_view token, size_t count = 1)
+	{
+		const auto id = this->tokens.insert(token);
+		if (id == this->counts.size())
+		{
+			this->counts.push_back(0);
+		}
+		this->counts[id] += count;
+	}
+
+	size_t size() const noexcept
+	{
+		return this->counts.size();
+	}
+};
+
+class corpus_tokenizer
+{
+public:
+	static constexpr size_t shards_per_thread = 8;
+
+	static std::vector<std::string_view> split(std::string_view text, size_t count)
+	{
+		std::vector<std::string_view> shards;
+		count = std::max<size_t>(std::min(count, text.size()), 1);
+		shards.reserve(count);
+		size_t begin = 0;
+		for (size_t i = 1; i <= count && begin != text.size(); i++)
+		{
+			auto end = (i == count) ? text.size() : std::max(begin, text.size() / count * i);
+			while (end != text.size() && !_is_space(text[end]))
+			{
+				end++;
+			}
+			if (end != begin)
+			{
+				shards.push_back(text.substr(begin, end - begin));
+			}
+			begin = end;
+		}
+		return shards;
+	}
+
+	static corpus_vocabulary count(std::string_view text, size_t threads = std::thread::hardware_concurrency())
+	{
+		threads = std::max<size_t>(threads, 1);
+		const auto shards = split(text, threads * shards_per_thread);
+		std::vector<corpus_vocabulary> vocabularies(shards.size());
+		std::atomic<size_t> next = 0;
+		{
+			std::vector<std::jthread> workers;
+			for (size_t i = 0; i != std::min(threads, shards.size()); i++)
+			{
+				workers.emplace_back([&]() {
+					for (auto index = next++; index < shards.size(); index = next++)
+					{
+						auto& vocabulary = vocabularies[index];
+						string_tokenizer::for_each_token(shards[index], [&](std::string_view token) {
+							vocabulary.add(token);
+						});
+					}
+				});
+			}
+		}
+		return merge(vocabularies);
+	}
+
+	static corpus_vocabulary count_file(const std::filesystem::path& path, size_t threads = std::thread::hardware_concurrency())
+	{
+		const mapped_file file(path, mapped_file::access_kind::sequential);
+		return count(file.view(), threads);
+	}
+
+	static corpus_vocabulary merge(const std::vector<corpus_vocabulary>& vocabularies)
+	{
+		corpus_vocabulary result;
+		const auto largest = std::max_element(vocabularies.begin(), vocabularies.end(), [](const auto& a, const auto& b) { return a.size() < b.size(); });
+		if (largest != vocabularies.end())
+		{
+			result.tokens.reserve(largest->size());
+			result.counts.reserve(largest->size());
+		}
+		for (const auto& vocabulary : vocabularies)
+		{
+			for (string_tokenizer::id_type id = 0; id != vocabulary.size(); id++)
+			{
+				result.add(vocabulary.tokens.find_one(id), vocabulary.counts[id]);
+			}
+		}
+		return result;
+	}
+private:
+	static constexpr bool _is_space(const char value) noexcept
+	{
+		return value == ' ' || (value >= '\t' && value <= '\r');
+	}
+};
@@ -0,0 +1,234 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include "ai.hpp"
+#include "mapped_file.hpp"
+
+class encoded_dataset
+{
+public:
+	using value_type = ai::value_type;
+	static constexpr size_t alignment = 64;
+
+	struct sample
+	{
+		std::span<const value_type> inputs;
+		std::span<const value_type> targets;
+		std::span<const value_type> padding;
+		size_t input_length;
+		size_t target_length;
+
+		ai::array_type input(size_t step) const
+		{
+			const auto width = this->padding.size();
+			const auto offset = step * width;
+			const auto row = (offset < this->inputs.size()) ? this->inputs.subspan(offset, width) : this->padding;
+			return ai::array_type(row.data(), row.size());
+		}
+	};
+private:
+	struct _header
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t width;
+		std::uint64_t count;
+		std::uint64_t source_hash;
+		std::uint64_t data_size;
+	};
+
+	struct _entry
+	{
+		std::uint64_t inputs;
+		std::uint64_t targets;
+		std::uint32_t input_length;
+		std::uint32_t target_length;
+	};
+
+	static constexpr char _magic[8]{ 'A', 'I', 'D', 'A', 'T', 'S', 'E', 'T' };
+	static constexpr std::uint32_t _version = 2;
+
+	mapped_file _file;
+	const _header* _info;
+	const _entry* _entries;
+	const value_type* _padding;
+	const value_type* _data;
+public:
+	explicit encoded_dataset(const std::filesystem::path& path) : _file(path)
+	{
+		const auto data = this->_file.data();
+		const auto size = this->_file.size();
+		this->_info = (const _header*)data;
+		if (size < sizeof(_header) || std::memcmp(this->_info->magic, _magic, sizeof(_magic)) != 0 || this->_info->version != _version)
+		{
+			throw std::runtime_error("invalid dataset file");
+		}
+		const auto [entries, padding, values] = _layout(this->_info->count, this->_info->width);
+		if (size < values + this->_info->data_size * sizeof(value_type))
+		{
+			throw std::runtime_error("invalid dataset file");
+		}
+		this->_entries = (const _entry*)(data + entries);
+		this->_padding = (const value_type*)(data + padding);
+		this->_data = (const value_type*)(data + values);
+	}
+
+	sample operator[](size_t index) const noexcept
+	{
+		const auto& entry = this->_entries[index];
+		const auto width = this->width();
+		const auto steps = (size_t)entry.target_length + 1;
+		return {
+			.inputs = { this->_data + entry.inputs, std::max<size_t>(entry.input_length, steps) * width },
+			.targets = { this->_data + entry.targets, steps * width },
+			.padding = { this->_padding, width },
+			.input_length = entry.input_length,
+			.target_length = entry.target_length,
+		};
+	}
+
+	size_t size() const noexcept
+	{
+		return (size_t)this->_info->count;
+	}
+
+	size_t width() const noexcept
+	{
+		return this->_info->width;
+	}
+
+	std::uint64_t source_hash() const noexcept
+	{
+		return this->_info->source_hash;
+	}
+
+	template<typename encoder_type>
+	static void write(const std::vector<std::pair<std::string, std::string>>& samples, encoder_type&& encode, const ai::array_type& padding, std::uint32_t encoder_version, const std::filesystem::path& path)
+	{
+		const auto width = padding.size();
+		if (width == 0)
+		{
+			throw std::invalid_argument("invalid size");
+		}
+		const auto row_alignment = alignment / sizeof(value_type);
+		const auto align = [&](size_t value) { return (value + row_alignment - 1) / row_alignment * row_alignment; };
+
+		std::vector<_entry> entries;
+		std::vector<value_type> values;
+		entries.reserve(samples.size());
+		const auto append = [&](const std::vector<ai::array_type>& rows, size_t count) {
+			const auto offset = values.size();
+			values.resize(align(offset + count * width));
+			for (size_t i = 0; i != count; i++)
+			{
+				const auto& row = (i < rows.size()) ? rows[i] : padding;
+				if (row.size() != width)
+				{
+					throw std::invalid_argument("invalid size");
+				}
+				std::copy(std::begin(row), std::end(row), values.begin() + offset + i * width);
+			}
+			return (std::uint64_t)offset;
+		};
+		for (const auto& [input, target] : samples)
+		{
+			const auto input_rows = encode(input);
+			const auto target_rows = encode(target);
+			const auto steps = target_rows.size() + 1;
+			_entry entry{};
+			entry.input_length = (std::uint32_t)input_rows.size();
+			entry.target_length = (std::uint32_t)target_rows.size();
+			entry.inputs = append(input_rows, std::max(input_rows.size(), steps));
+			entry.targets = append(target_rows, steps);
+			entries.push_back(entry);
+		}
+
+		_header info{};
+		std::memcpy(info.magic, _magic, sizeof(_magic));
+		info.version = _version;
+		info.width = (std::uint32_t)width;
+		info.count = samples.size();
+		info.source_hash = hash(samples, padding, encoder_version);
+		info.data_size = values.size();
+
+		const auto [entries_offset, padding_offset, values_offset] = _layout(info.count, width);
+		std::ofstream output_stream(path, std::ios::binary | std::ios::trunc);
+		if (!output_stream)
+		{
+			throw std::runtime_error("cannot open dataset file");
+		}
+		_write_at(output_stream, 0, &info, sizeof(info));
+		_write_at(output_stream, entries_offset, entries.data(), entries.size() * sizeof(entries[0]));
+		_write_at(output_stream, padding_offset, std::begin(padding), width * sizeof(value_type));
+		_write_at(output_stream, values_offset, values.data(), values.size() * sizeof(value_type));
+		if (!output_stream)
+		{
+			throw std::runtime_error("cannot write dataset file");
+		}
+	}
+
+	static bool matches(const std::filesystem::path& path, std::uint64_t source_hash) noexcept
+	{
+		try
+		{
+			return encoded_dataset(path).source_hash() == source_hash;
+		}
+		catch (const std::exception&)
+		{
+			return false;
+		}
+	}
+
+	static std::uint64_t hash(const std::vector<std::pair<std::string, std::string>>& samples, const ai::array_type& padding, std::uint32_t encoder_version) noexcept
+	{
+		auto result = 0xCBF29CE484222325ull;
+		const auto append = [&](std::string_view value) {
+			for (const auto element : value)
+			{
+				result = (result ^ (unsigned char)element) * 0x100000001B3ull;
+			}
+			result = (result ^ value.size()) * 0x100000001B3ull;
+		};
+		append({ (const char*)&encoder_version, sizeof(encoder_version) });
+		append({ (const char*)std::begin(padding), padding.size() * sizeof(value_type) });
+		for (const auto& [input, target] : samples)
+		{
+			append(input);
+			append(target);
+		}
+		return result;
+	}
+private:
+	struct _sections
+	{
+		size_t entries, padding, values;
+	};
+
+	static constexpr size_t _align(size_t value) noexcept
+	{
+		return (value + alignment - 1) & ~(alignment - 1);
+	}
+
+	static constexpr _sections _layout(size_t count, size_t width) noexcept
+	{
+		_sections result{};
+		result.entries = _align(sizeof(_header));
+		result.padding = _align(result.entries + count * sizeof(_entry));
+		result.values = _align(result.padding + width * sizeof(value_type));
+		return result;
+	}
+
+	static void _write_at(std::ostream& output_stream, size_t position, const void* data, size_t size)
+	{
+		output_stream.seekp(position);
+		output_stream.write((const char*)data, size);
+	}
+};
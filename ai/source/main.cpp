@@ -1,4 +1,5 @@
 #include "main.hpp"
+#include "encoded_dataset.hpp"
 
 static constexpr ai::value_type step = 0.0f;
 static size_t array_index = std::numeric_limits<size_t>::max();
@@ -32,6 +33,8 @@ constexpr type normalize(type value, type min, type max, type newmin, type newma
 }
 
 
+static constexpr std::uint32_t encoder_version = 1;
+
 ai::array_type to_bit_array(char value)
 {
 	ai::array_type result(CHAR_BIT);
@@ -99,41 +102,48 @@ int main()
 	//}
 
 	static const auto zero = to_bit_array(0);
+	const std::filesystem::path dataset_path = "dataset.bin";
+	if (!encoded_dataset::matches(dataset_path, encoded_dataset::hash(dataset, zero, encoder_version)))
+	{
+		encoded_dataset::write(dataset, input_string, zero, encoder_version, dataset_path);
+	}
+	const encoded_dataset encoded(dataset_path);
+	if (encoded.width() != network.input_size() || encoded.width() != network.output_size())
+	{
+		throw std::invalid_argument("invalid size");
+	}
+
 	const auto target_error = 0.01f;
 	for (size_t epoch = 0; epoch != std::numeric_limits<size_t>::max(); epoch++)
 	{
-		//static std::mt19937 generator(std::random_device{}());
-		//std::shuffle(dataset.begin(), dataset.end(), generator);
-		const auto error = std::reduce(dataset.cbegin(), dataset.cend(), ai::value_type(0), [&](auto value, const auto& sample) {
-			const auto cast_input = input_string(sample.first);
-			const auto cast_target = input_string(sample.second);
-			for (size_t i = 0; i != cast_target.size() + 1; i++)
-			{
-				value += network.train({ i < cast_input.size() ? cast_input[i] : zero, i < cast_target.size() ? cast_target[i] : zero });
-			}
-			return value / sample.second.size();
-		}) / dataset.size();
+		ai::value_type error = 0;
+		for (size_t index = 0; index != encoded.size(); index++)
+		{
+			const auto sample = encoded[index];
+			error += network.train(sample.inputs, sample.targets) / std::max<size_t>(sample.target_length, 1);
+		}
+		error /= encoded.size();
 
 		const auto success = error < target_error;
 		if (epoch % 1000 == 0 || success)
 		{
 			std::println("\033[0;0Hepoch {:<20} error {:.6f}", epoch, error);
 			std::cout.flush();
-			for (const auto& [input, target] : dataset)
+			for (size_t index = 0; index != encoded.size(); index++)
 			{
+				const auto& [input, target] = dataset[index];
+				const auto sample = encoded[index];
 				std::vector<ai::array_type> output;
-				const auto cast_input = input_string(input);
-				const auto cast_target = input_string(target);
 				for (size_t i = 0; i != 32; i++)
 				{
-					const auto temp = network.predict(i < cast_input.size() ? cast_input[i] : zero);
+					const auto temp = network.predict(sample.input(i));
 					if ((temp == zero).min() == true)
 					{
 						break;
 					}
 					output.push_back(temp);
 				}
-				std::cout << "\33[2K\r\"" << output_string(cast_input) << "\" : \"" << output_string(cast_target) << "\" : \"" << output_string(output) << "\"" << std::endl;
+				std::cout << "\33[2K\r\"" << input << "\" : \"" << target << "\" : \"" << output_string(output) << "\"" << std::endl;
 				std::cout.flush();
 			}
 			if (success)
@@ -16,6 +16,7 @@
 #include <chrono>
 #include <conio.h>
 #include "tokenizer.hpp"
+#include "sparse.hpp"
 #include "ai.hpp"
 
 namespace ai
@@ -83,18 +84,22 @@ namespace ai
 		virtual size_t output_size() const noexcept = 0;
 	};
 
-	class neuron : public base_neuron, public tanh
+	template<typename activation_type = tanh, typename update_type = adam_optimizer>
+	class basic_neuron : public base_neuron, public activation_type
 	{
+	public:
+		using optimizer_type = update_type;
 	protected:
 		array_type _weights;
 		value_type _bias, _sum, _output, _output_weight;
-		std::vector<adam_optimizer> _weights_optimizer;
-		adam_optimizer _bias_optimizer, _output_weight_optimizer;
+		std::vector<optimizer_type> _weights_optimizer;
+		optimizer_type _bias_optimizer, _output_weight_optimizer;
+		std::vector<bool> _pruned;
 	public:
-		explicit neuron(size_t size = 1) : _weights(size), _bias(random_real_value()), _sum(0), _output(0), _output_weight(random_real_value())
+		explicit basic_neuron(size_t size = 1, const optimizer_type& prototype = optimizer_type()) : _weights(size), _bias(random_real_value()), _sum(0), _output(0), _output_weight(random_real_value()),
+			_weights_optimizer(size, prototype), _bias_optimizer(prototype), _output_weight_optimizer(prototype), _pruned(size, false)
 		{
 			random_real_array(this->_weights);
-			_weights_optimizer.resize(size);
 		}
 
 		size_t size() const noexcept override
@@ -109,17 +114,47 @@ namespace ai
 
 		float predict(const array_type& inputs) override
 		{
-			this->_sum = dot(inputs, this->_weights) + this->_bias + (this->_output * this->_output_weight);
+			return this->activate(dot(inputs, this->_weights));
+		}
+
+		float activate(value_type weighted_sum) noexcept
+		{
+			this->_sum = weighted_sum + this->_bias + (this->_output * this->_output_weight);
 			return this->activation(this->_sum);
 		}
 
+		const array_type& weights() const noexcept
+		{
+			return this->_weights;
+		}
+
+		const std::vector<bool>& pruned() const noexcept
+		{
+			return this->_pruned;
+		}
+
+		size_t prune(value_type threshold) noexcept
+		{
+			size_t count = 0;
+			for (size_t i = 0; i != this->_weights.size(); i++)
+			{
+				if (!this->_pruned[i] && std::abs(this->_weights[i]) <= threshold)
+				{
+					this->_weights[i] = 0;
+					this->_pruned[i] = true;
+					count++;
+				}
+			}
+			return count;
+		}
+
 		array_type update(const array_type& inputs, float gradiend) override
 		{
 			gradiend *= this->derivative(this->_sum);
 			const auto result = gradiend * this->_weights;
-			for (auto&& [weight, value, optimizer] : std::views::zip(this->_weights, inputs, this->_weights_optimizer))
+			for (auto&& [weight, value, optimizer, pruned] : std::views::zip(this->_weights, inputs, this->_weights_optimizer, this->_pruned))
 			{
-				optimizer.update(weight, gradiend * value);
+				if (!pruned) optimizer.update(weight, gradiend * value);
 			}
 			this->_bias_optimizer.update(this->_bias, gradiend);
 			this->_output_weight_optimizer.update(this->_output_weight, gradiend * this->_output);
@@ -128,18 +163,31 @@ namespace ai
 	};
 
 
-	struct layer : public base_layer
+	template<typename neuron_type = basic_neuron<>>
+	struct basic_layer : public base_layer
 	{
+	public:
+		using optimizer_type = typename neuron_type::optimizer_type;
+		static constexpr value_type sparse_density = 0.3f;
 	private:
-		std::vector<neuron> _neurons;
+		std::vector<neuron_type> _neurons;
+		csr_matrix _sparse;
 	public:
-		explicit layer(size_t input_size = 1, size_t output_size = 1) noexcept : _neurons(output_size, neuron(input_size))
+		explicit basic_layer(size_t input_size = 1, size_t output_size = 1, const optimizer_type& prototype = optimizer_type()) : _neurons(output_size, neuron_type(input_size, prototype))
 		{
 		}
 
 		array_type predict(const array_type& inputs) override
 		{
 			array_type outputs(this->_neurons.size());
+			if (!this->_sparse.empty())
+			{
+				this->_sparse.multiply(inputs, outputs);
+				std::transform(std::execution::par_unseq, this->_neurons.begin(), this->_neurons.end(), std::begin(outputs), std::begin(outputs), [&](auto& neuron, auto sum) {
+					return neuron.activate(sum);
+				});
+				return outputs;
+			}
 			std::transform(std::execution::par_unseq, this->_neurons.begin(), this->_neurons.end(), std::begin(outputs), [&](auto& neuron) {
 				return neuron.predict(inputs);
 			});
@@ -149,10 +197,15 @@ namespace ai
 		array_type update(const array_type& inputs, const array_type& gradients) override
 		{
 			auto zipped = std::views::zip(this->_neurons, gradients);
-			return std::transform_reduce(std::execution::par_unseq, zipped.begin(), zipped.end(), array_type(0.0f, inputs.size()), std::plus(), [&](auto tuple) {
+			auto result = std::transform_reduce(std::execution::par_unseq, zipped.begin(), zipped.end(), array_type(0.0f, inputs.size()), std::plus(), [&](auto tuple) {
 				const auto [neuron, gradient] = tuple;
 				return neuron.update(inputs, gradient);
 			});
+			if (!this->_sparse.empty())
+			{
+				for (size_t row = 0; row != this->_neurons.size(); row++) this->_sparse.assign_row(row, this->_neurons[row].weights());
+			}
+			return result;
 		}
 
 		void reset() noexcept
@@ -160,6 +213,61 @@ namespace ai
 			for (auto& neuron : this->_neurons) neuron.reset();
 		}
 
+		size_t prune(value_type threshold)
+		{
+			const auto count = std::transform_reduce(this->_neurons.begin(), this->_neurons.end(), size_t(0), std::plus(), [&](auto& neuron) {
+				return neuron.prune(threshold);
+			});
+			this->compress();
+			return count;
+		}
+
+		value_type prune_to_sparsity(value_type sparsity)
+		{
+			std::vector<value_type> magnitudes;
+			magnitudes.reserve(this->input_size() * this->output_size());
+			for (const auto& neuron : this->_neurons)
+			{
+				for (const auto weight : neuron.weights()) magnitudes.push_back(std::abs(weight));
+			}
+			const auto count = (size_t)(std::clamp<value_type>(sparsity, 0, 1) * magnitudes.size());
+			if (count == 0)
+			{
+				this->compress();
+				return 0;
+			}
+			std::nth_element(magnitudes.begin(), magnitudes.begin() + (count - 1), magnitudes.end());
+			const auto threshold = magnitudes[count - 1];
+			this->prune(threshold);
+			return threshold;
+		}
+
+		csr_matrix to_csr() const
+		{
+			csr_matrix result(this->output_size(), this->input_size());
+			for (const auto& neuron : this->_neurons) result.push_row(neuron.weights(), neuron.pruned());
+			return result;
+		}
+
+		void compress()
+		{
+			auto sparse = this->to_csr();
+			this->_sparse = (sparse.density() <= sparse_density) ? std::move(sparse) : csr_matrix();
+		}
+
+		value_type density() const noexcept
+		{
+			const auto nonzero = std::transform_reduce(this->_neurons.begin(), this->_neurons.end(), size_t(0), std::plus(), [](const auto& neuron) {
+				return (size_t)std::count_if(std::begin(neuron.weights()), std::end(neuron.weights()), [](auto weight) { return weight != 0; });
+			});
+			return value_type(nonzero) / value_type(this->input_size() * this->output_size());
+		}
+
+		bool sparse() const noexcept
+		{
+			return !this->_sparse.empty();
+		}
+
 		size_t input_size() const noexcept
 		{
 			return this->_neurons[0].size();
@@ -174,12 +282,15 @@ namespace ai
 		//friend std::istream& operator>>(std::istream&, layer&);
 	};
 
-	struct network
+	template<typename layer_type = basic_layer<>>
+	struct basic_network
 	{
+	public:
+		using optimizer_type = typename layer_type::optimizer_type;
 	private:
-		std::vector<layer> _layers;
+		std::vector<layer_type> _layers;
 	public:
-		explicit network(size_t input_size, size_t output_size, size_t hidden_matrix_size = 0)
+		explicit basic_network(size_t input_size, size_t output_size, size_t hidden_matrix_size = 0, const optimizer_type& prototype = optimizer_type())
 		{
 			if (input_size < 1 || output_size < 1)
 			{
@@ -191,7 +302,7 @@ namespace ai
 			this->_layers.resize(size);
 			for (size_t i = 0; i != size; i++)
 			{
-				this->_layers[i] = layer(current_input_size, current_output_size);
+				this->_layers[i] = layer_type(current_input_size, current_output_size, prototype);
 				current_input_size = current_output_size;
 				current_output_size = (i == size - 2) ? output_size : hidden_matrix_size;
 			}
@@ -209,24 +320,58 @@ namespace ai
 
 		float train(const std::pair<array_type, array_type>& dataset)
 		{
-			std::vector<array_type> values;
-			values.reserve(this->_layers.size() + 1);
-			values.push_back(dataset.first);
-			for (auto& layer : this->_layers)
-			{
-				values.push_back(layer.predict(values.back()));
-			}
-			auto outputs = values.back();
+			auto values = this->_forward(dataset.first);
+			const auto outputs = values.back();
 			values.pop_back();
-			auto gradients = dataset.second - outputs;
+			array_type gradients = dataset.second - outputs;
 			const auto error = (gradients * gradients).sum() / gradients.size();
-			for (auto&& [layer, values] : std::ranges::reverse_view(std::views::zip(this->_layers, values)))
+			this->_backward(values, gradients);
+			return error;
+		}
+
+		value_type train(std::span<const value_type> inputs, std::span<const value_type> targets)
+		{
+			const auto input_size = this->input_size();
+			const auto output_size = this->output_size();
+			const auto steps = targets.size() / output_size;
+			if (targets.size() % output_size != 0 || inputs.size() < steps * input_size)
+			{
+				throw std::invalid_argument("invalid size");
+			}
+			std::pair<array_type, array_type> step{ array_type(input_size), array_type(output_size) };
+			value_type error = 0;
+			for (size_t i = 0; i != steps; i++)
 			{
-				gradients = layer.update(values, gradients);
+				std::copy_n(inputs.begin() + i * input_size, input_size, std::begin(step.first));
+				std::copy_n(targets.begin() + i * output_size, output_size, std::begin(step.second));
+				error += this->train(step);
 			}
 			return error;
 		}
 
+		template<typename head_type>
+		value_type train(const array_type& inputs, size_t target, head_type& head)
+		{
+			auto values = this->_forward(inputs);
+			const auto outputs = values.back();
+			values.pop_back();
+			auto [loss, gradients] = head.train(outputs, target);
+			this->_backward(values, gradients);
+			return loss;
+		}
+
+		void prune(const std::vector<value_type>& sparsities)
+		{
+			if (sparsities.size() != this->_layers.size())
+			{
+				throw std::invalid_argument("invalid size");
+			}
+			for (auto&& [layer, sparsity] : std::views::zip(this->_layers, sparsities))
+			{
+				layer.prune_to_sparsity(sparsity);
+			}
+		}
+
 		void reset() noexcept
 		{
 			for (auto& layer : this->_layers) layer.reset();
@@ -241,11 +386,35 @@ namespace ai
 		{
 			return this->_layers.back().output_size();
 		}
+	private:
+		std::vector<array_type> _forward(const array_type& inputs)
+		{
+			std::vector<array_type> values;
+			values.reserve(this->_layers.size() + 1);
+			values.push_back(inputs);
+			for (auto& layer : this->_layers)
+			{
+				values.push_back(layer.predict(values.back()));
+			}
+			return values;
+		}
 
+		void _backward(const std::vector<array_type>& values, array_type gradients)
+		{
+			for (auto&& [layer, inputs] : std::ranges::reverse_view(std::views::zip(this->_layers, values)))
+			{
+				gradients = layer.update(inputs, gradients);
+			}
+		}
+	public:
 		//friend std::ostream& operator<<(std::ostream&, const network&);
 		//friend std::istream& operator>>(std::istream&, network&);
 	};
 
+	using neuron = basic_neuron<>;
+	using layer = basic_layer<>;
+	using network = basic_network<>;
+
 	template<typename type>
 	void bin_write(std::ostream& output_stream, const type& value)
 	{
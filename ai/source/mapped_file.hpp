@@ -0,0 +1,134 @@
+#pragma once
+
+#include <string_view>
+#include <filesystem>
+#include <system_error>
+#include <utility>
+#include <cerrno>
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+class mapped_file
+{
+public:
+	enum class access_kind { normal, sequential, random };
+private:
+	const char* _data;
+	size_t _size;
+public:
+	explicit mapped_file(const std::filesystem::path& path, access_kind access = access_kind::normal) : _data(nullptr), _size(0)
+	{
+#ifdef _WIN32
+		const DWORD flags = (access == access_kind::sequential) ? FILE_FLAG_SEQUENTIAL_SCAN : (access == access_kind::random) ? FILE_FLAG_RANDOM_ACCESS : 0;
+		const auto file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, flags, nullptr);
+		if (file == INVALID_HANDLE_VALUE)
+		{
+			throw std::system_error((int)GetLastError(), std::system_category(), "CreateFile");
+		}
+		LARGE_INTEGER size{};
+		GetFileSizeEx(file, &size);
+		this->_size = (size_t)size.QuadPart;
+		if (this->_size)
+		{
+			const auto mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			if (mapping)
+			{
+				this->_data = (const char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+				CloseHandle(mapping);
+			}
+		}
+		const auto error = GetLastError();
+		CloseHandle(file);
+		if (this->_size && !this->_data)
+		{
+			throw std::system_error((int)error, std::system_category(), "MapViewOfFile");
+		}
+#else
+		const auto file = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		if (file == -1)
+		{
+			throw std::system_error(errno, std::generic_category(), "open");
+		}
+		struct stat status {};
+		if (::fstat(file, &status) == -1)
+		{
+			const auto error = errno;
+			::close(file);
+			throw std::system_error(error, std::generic_category(), "fstat");
+		}
+		if (status.st_size > 0)
+		{
+			this->_size = (size_t)status.st_size;
+			const auto data = ::mmap(nullptr, this->_size, PROT_READ, MAP_PRIVATE, file, 0);
+			this->_data = (data != MAP_FAILED) ? (const char*)data : nullptr;
+		}
+		const auto error = errno;
+		::close(file);
+		if (this->_size && !this->_data)
+		{
+			throw std::system_error(error, std::generic_category(), "mmap");
+		}
+		if (this->_data && access != access_kind::normal)
+		{
+			::madvise((void*)this->_data, this->_size, (access == access_kind::sequential) ? MADV_SEQUENTIAL : MADV_RANDOM);
+		}
+#endif
+	}
+
+	mapped_file(mapped_file&& other) noexcept : _data(std::exchange(other._data, nullptr)), _size(std::exchange(other._size, 0))
+	{
+	}
+
+	mapped_file& operator=(mapped_file&& other) noexcept
+	{
+		if (this != &other)
+		{
+			this->_unmap();
+			this->_data = std::exchange(other._data, nullptr);
+			this->_size = std::exchange(other._size, 0);
+		}
+		return *this;
+	}
+
+	~mapped_file()
+	{
+		this->_unmap();
+	}
+
+	const char* data() const noexcept
+	{
+		return this->_data;
+	}
+
+	size_t size() const noexcept
+	{
+		return this->_size;
+	}
+
+	std::string_view view() const noexcept
+	{
+		return { this->_data, this->_size };
+	}
+private:
+	void _unmap() noexcept
+	{
+		if (this->_data)
+		{
+#ifdef _WIN32
+			UnmapViewOfFile(this->_data);
+#else
+			::munmap((void*)this->_data, this->_size);
+#endif
+		}
+	}
+};
@@ -0,0 +1,195 @@
+#pragma once
+
+#include <vector>
+#include <random>
+#include <cmath>
+#include <utility>
+#include "main.hpp"
+
+namespace ai
+{
+	class candidate_sampler
+	{
+	private:
+		const size_t _size;
+		std::vector<value_type> _probabilities;
+		std::discrete_distribution<size_t> _distribution;
+		std::mt19937 _generator;
+	public:
+		explicit candidate_sampler(size_t size) : _size(size), _generator(std::random_device{}())
+		{
+			if (size < 1)
+			{
+				throw std::invalid_argument("invalid size");
+			}
+		}
+
+		candidate_sampler(const std::vector<size_t>& counts, value_type power = 0.75f) : _size(counts.size()), _generator(std::random_device{}())
+		{
+			if (counts.empty())
+			{
+				throw std::invalid_argument("invalid size");
+			}
+			std::vector<double> weights(counts.size());
+			std::transform(counts.begin(), counts.end(), weights.begin(), [&](auto count) {
+				return std::pow(double(count) + 1, double(power));
+			});
+			this->_distribution = std::discrete_distribution<size_t>(weights.begin(), weights.end());
+			const auto probabilities = this->_distribution.probabilities();
+			this->_probabilities.assign(probabilities.begin(), probabilities.end());
+		}
+
+		size_t sample() noexcept
+		{
+			if (this->_probabilities.empty())
+			{
+				return std::uniform_int_distribution<size_t>(0, this->_size - 1)(this->_generator);
+			}
+			return this->_distribution(this->_generator);
+		}
+
+		value_type probability(size_t index) const noexcept
+		{
+			return this->_probabilities.empty() ? value_type(1) / this->_size : this->_probabilities[index];
+		}
+
+		size_t size() const noexcept
+		{
+			return this->_size;
+		}
+	};
+
+	class softmax_layer
+	{
+	private:
+		const size_t _input_size, _size;
+		array_type _weights, _bias;
+		std::vector<adam_optimizer> _weights_optimizer, _bias_optimizer;
+	public:
+		explicit softmax_layer(size_t input_size = 1, size_t output_size = 1) : _input_size(input_size), _size(output_size),
+			_weights(input_size * output_size), _bias(value_type(), output_size), _weights_optimizer(input_size * output_size), _bias_optimizer(output_size)
+		{
+			if (input_size < 1 || output_size < 1)
+			{
+				throw std::invalid_argument("invalid size");
+			}
+			random_real_array(this->_weights) *= 1 / std::sqrt(value_type(input_size));
+		}
+
+		array_type predict(const array_type& inputs) const
+		{
+			array_type outputs(this->_size);
+			multiply(this->_weights, inputs, outputs);
+			outputs += this->_bias;
+			return softmax(outputs);
+		}
+
+		std::pair<value_type, array_type> train(const array_type& inputs, size_t target)
+		{
+			if (target >= this->_size)
+			{
+				throw std::out_of_range("invalid target");
+			}
+			auto gradients = this->predict(inputs);
+			gradients *= -1;
+			const auto loss = -std::log(std::max(-gradients[target], std::numeric_limits<value_type>::min()));
+			gradients[target] += 1;
+
+			array_type result(this->_input_size);
+			multiply_transposed(this->_weights, gradients, result);
+			for (size_t row = 0; row != this->_size; row++)
+			{
+				this->_update(row, inputs, gradients[row]);
+			}
+			return { loss, result };
+		}
+
+		std::pair<value_type, array_type> train(const array_type& inputs, size_t target, candidate_sampler& sampler, size_t samples)
+		{
+			if (target >= this->_size)
+			{
+				throw std::out_of_range("invalid target");
+			}
+			if (samples < 1 || sampler.size() != this->_size)
+			{
+				throw std::invalid_argument("invalid sampler");
+			}
+			std::vector<size_t> candidates{ target };
+			candidates.reserve(samples + 1);
+			for (size_t i = 0; i != samples; i++)
+			{
+				if (const auto candidate = sampler.sample(); candidate != target)
+				{
+					candidates.push_back(candidate);
+				}
+			}
+
+			array_type gradients(candidates.size());
+			for (size_t i = 0; i != candidates.size(); i++)
+			{
+				const auto row = candidates[i];
+				gradients[i] = this->_logit(row, inputs) - std::log(value_type(samples) * sampler.probability(row));
+			}
+			softmax(gradients) *= -1;
+			const auto loss = -std::log(std::max(-gradients[0], std::numeric_limits<value_type>::min()));
+			gradients[0] += 1;
+
+			array_type result(value_type(), this->_input_size);
+			for (size_t i = 0; i != candidates.size(); i++)
+			{
+				const auto begin = std::begin(this->_weights) + candidates[i] * this->_input_size;
+				std::transform(std::execution::unseq, begin, begin + this->_input_size, std::begin(result), std::begin(result), [&](auto weight, auto value) {
+					return value + weight * gradients[i];
+				});
+			}
+			for (size_t i = 0; i != candidates.size(); i++)
+			{
+				this->_update(candidates[i], inputs, gradients[i]);
+			}
+			return { loss, result };
+		}
+
+		size_t input_size() const noexcept
+		{
+			return this->_input_size;
+		}
+
+		size_t output_size() const noexcept
+		{
+			return this->_size;
+		}
+	private:
+		value_type _logit(size_t row, const array_type& inputs) const noexcept
+		{
+			const auto begin = std::begin(this->_weights) + row * this->_input_size;
+			return std::transform_reduce(std::execution::unseq, begin, begin + this->_input_size, std::begin(inputs), this->_bias[row]);
+		}
+
+		void _update(size_t row, const array_type& inputs, value_type gradient) noexcept
+		{
+			const auto offset = row * this->_input_size;
+			for (size_t column = 0; column != this->_input_size; column++)
+			{
+				this->_weights_optimizer[offset + column].update(this->_weights[offset + column], gradient * inputs[column]);
+			}
+			this->_bias_optimizer[row].update(this->_bias[row], gradient);
+		}
+	};
+
+	class sampled_softmax
+	{
+	private:
+		softmax_layer& _layer;
+		candidate_sampler& _sampler;
+		const size_t _samples;
+	public:
+		sampled_softmax(softmax_layer& layer, candidate_sampler& sampler, size_t samples) noexcept : _layer(layer), _sampler(sampler), _samples(samples)
+		{
+		}
+
+		std::pair<value_type, array_type> train(const array_type& inputs, size_t target)
+		{
+			return this->_layer.train(inputs, target, this->_sampler, this->_samples);
+		}
+	};
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <vector>
+#include <cstdint>
+#include "ai.hpp"
+
+namespace ai
+{
+	struct csr_matrix
+	{
+		using index_type = std::uint32_t;
+
+		size_t rows = 0, columns = 0;
+		std::vector<value_type> values;
+		std::vector<index_type> indices;
+		std::vector<index_type> offsets;
+
+		csr_matrix() noexcept = default;
+
+		csr_matrix(size_t rows, size_t columns) : rows(rows), columns(columns), offsets(1, 0)
+		{
+			this->offsets.reserve(rows + 1);
+		}
+
+		template<typename range_type>
+		void push_row(const range_type& row, const std::vector<bool>& pruned)
+		{
+			index_type column = 0;
+			for (const auto value : row)
+			{
+				if (!pruned[column])
+				{
+					this->values.push_back(value);
+					this->indices.push_back(column);
+				}
+				column++;
+			}
+			this->offsets.push_back((index_type)this->values.size());
+		}
+
+		template<typename range_type>
+		void assign_row(size_t row, const range_type& weights) noexcept
+		{
+			for (auto index = this->offsets[row]; index != this->offsets[row + 1]; index++)
+			{
+				this->values[index] = weights[this->indices[index]];
+			}
+		}
+
+		array_type& multiply(const array_type& vector, array_type& result) const noexcept
+		{
+			for (size_t row = 0; row != this->rows; row++)
+			{
+				value_type sum = 0;
+				for (auto index = this->offsets[row]; index != this->offsets[row + 1]; index++)
+				{
+					sum += this->values[index] * vector[this->indices[index]];
+				}
+				result[row] = sum;
+			}
+			return result;
+		}
+
+		size_t nonzero() const noexcept
+		{
+			return this->values.size();
+		}
+
+		value_type density() const noexcept
+		{
+			return (this->rows && this->columns) ? value_type(this->nonzero()) / value_type(this->rows * this->columns) : value_type(1);
+		}
+
+		bool empty() const noexcept
+		{
+			return this->rows == 0;
+		}
+	};
+}
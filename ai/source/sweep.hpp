@@ -0,0 +1,217 @@
+#pragma once
+
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <random>
+#include <chrono>
+#include <algorithm>
+#include <ostream>
+#include <print>
+#include "main.hpp"
+
+namespace ai
+{
+	enum class activation_kind { sigmoid, tanh, softplus, swish };
+	enum class optimizer_kind { sgd, adam };
+
+	constexpr const char* to_string(activation_kind value) noexcept
+	{
+		constexpr const char* names[]{ "sigmoid", "tanh", "softplus", "swish" };
+		return names[(size_t)value];
+	}
+
+	constexpr const char* to_string(optimizer_kind value) noexcept
+	{
+		constexpr const char* names[]{ "sgd", "adam" };
+		return names[(size_t)value];
+	}
+
+	struct sweep_trial
+	{
+		size_t hidden_size = 0;
+		value_type speed = 0.001f;
+		optimizer_kind optimizer = optimizer_kind::adam;
+		activation_kind activation = activation_kind::tanh;
+	};
+
+	struct sweep_result
+	{
+		size_t index = 0;
+		sweep_trial trial;
+		value_type error = std::numeric_limits<value_type>::infinity();
+		size_t epochs = 0;
+		bool stopped = false;
+		double seconds = 0;
+	};
+
+	struct sweep_space
+	{
+		std::vector<size_t> hidden_sizes{ 8 };
+		std::vector<value_type> speeds{ 0.001f };
+		std::vector<optimizer_kind> optimizers{ optimizer_kind::adam };
+		std::vector<activation_kind> activations{ activation_kind::tanh };
+
+		std::vector<sweep_trial> grid() const
+		{
+			std::vector<sweep_trial> trials;
+			trials.reserve(this->hidden_sizes.size() * this->speeds.size() * this->optimizers.size() * this->activations.size());
+			for (const auto hidden_size : this->hidden_sizes)
+				for (const auto speed : this->speeds)
+					for (const auto optimizer : this->optimizers)
+						for (const auto activation : this->activations)
+							trials.push_back({ hidden_size, speed, optimizer, activation });
+			return trials;
+		}
+
+		std::vector<sweep_trial> random(size_t count, std::uint32_t seed = std::random_device{}()) const
+		{
+			if (this->hidden_sizes.empty() || this->speeds.empty() || this->optimizers.empty() || this->activations.empty())
+			{
+				throw std::invalid_argument("empty space");
+			}
+			std::mt19937 generator(seed);
+			const auto [min_speed, max_speed] = std::minmax_element(this->speeds.begin(), this->speeds.end());
+			std::uniform_real_distribution<value_type> speed(std::log(*min_speed), std::log(*max_speed));
+			const auto pick = [&](const auto& values) {
+				return values[std::uniform_int_distribution<size_t>(0, values.size() - 1)(generator)];
+			};
+			std::vector<sweep_trial> trials(count);
+			for (auto& trial : trials)
+			{
+				trial = { pick(this->hidden_sizes), std::exp(speed(generator)), pick(this->optimizers), pick(this->activations) };
+			}
+			return trials;
+		}
+	};
+
+	struct sweep_options
+	{
+		size_t epochs = 10000;
+		size_t check_interval = 100;
+		size_t min_reports = 3;
+		size_t threads = std::max<size_t>(std::thread::hardware_concurrency(), 1);
+		value_type target_error = 0.01f;
+		value_type stop_ratio = 1.0f;
+	};
+
+	class sweep_runner
+	{
+	public:
+		using dataset_type = std::vector<std::pair<array_type, array_type>>;
+	private:
+		const std::shared_ptr<const dataset_type> _dataset;
+		const sweep_options _options;
+		std::mutex _mutex;
+		std::vector<std::vector<value_type>> _checkpoints;
+	public:
+		explicit sweep_runner(std::shared_ptr<const dataset_type> dataset, const sweep_options& options = {}) : _dataset(std::move(dataset)), _options(options)
+		{
+			if (!this->_dataset || this->_dataset->empty())
+			{
+				throw std::invalid_argument("empty dataset");
+			}
+			if (this->_options.check_interval == 0)
+			{
+				throw std::invalid_argument("invalid check interval");
+			}
+		}
+
+		std::vector<sweep_result> run(const std::vector<sweep_trial>& trials)
+		{
+			this->_checkpoints.assign(this->_options.epochs / this->_options.check_interval + 1, {});
+			std::vector<sweep_result> results(trials.size());
+			std::atomic<size_t> next = 0;
+			{
+				std::vector<std::jthread> workers;
+				for (size_t i = 0; i != std::min(this->_options.threads, trials.size()); i++)
+				{
+					workers.emplace_back([&]() {
+						for (auto index = next++; index < trials.size(); index = next++)
+						{
+							results[index] = this->_select_activation(index, trials[index]);
+						}
+					});
+				}
+			}
+			return results;
+		}
+
+		static void write(std::ostream& output_stream, const std::vector<sweep_result>& results)
+		{
+			std::println(output_stream, "index\thidden\toptimizer\tspeed\tactivation\tepochs\terror\tstopped\tseconds");
+			for (const auto& result : results)
+			{
+				std::println(output_stream, "{}\t{}\t{}\t{:g}\t{}\t{}\t{:.6f}\t{}\t{:.3f}", result.index, result.trial.hidden_size, to_string(result.trial.optimizer),
+					result.trial.speed, to_string(result.trial.activation), result.epochs, result.error, result.stopped, result.seconds);
+			}
+		}
+	private:
+		sweep_result _select_activation(size_t index, const sweep_trial& trial)
+		{
+			switch (trial.activation)
+			{
+				case activation_kind::sigmoid: return this->_select_optimizer<sigmoid>(index, trial);
+				case activation_kind::softplus: return this->_select_optimizer<softplus>(index, trial);
+				case activation_kind::swish: return this->_select_optimizer<swish>(index, trial);
+				default: return this->_select_optimizer<tanh>(index, trial);
+			}
+		}
+
+		template<typename activation_type>
+		sweep_result _select_optimizer(size_t index, const sweep_trial& trial)
+		{
+			if (trial.optimizer == optimizer_kind::sgd)
+			{
+				return this->_train<activation_type, sgd_optimizer>(index, trial, sgd_optimizer(trial.speed));
+			}
+			return this->_train<activation_type, adam_optimizer>(index, trial, adam_optimizer(trial.speed));
+		}
+
+		template<typename activation_type, typename optimizer_type>
+		sweep_result _train(size_t index, const sweep_trial& trial, const optimizer_type& prototype)
+		{
+			using network_type = basic_network<basic_layer<basic_neuron<activation_type, optimizer_type>>>;
+			const auto start = std::chrono::steady_clock::now();
+			const auto& dataset = *this->_dataset;
+			network_type network(dataset.front().first.size(), dataset.front().second.size(), trial.hidden_size, prototype);
+
+			sweep_result result{ .index = index, .trial = trial };
+			while (result.epochs != this->_options.epochs)
+			{
+				result.error = std::accumulate(dataset.cbegin(), dataset.cend(), value_type(0), [&](auto value, const auto& sample) {
+					return value + network.train(sample);
+				}) / dataset.size();
+				result.epochs++;
+				if (!std::isfinite(result.error) || result.error < this->_options.target_error)
+				{
+					break;
+				}
+				if (result.epochs % this->_options.check_interval == 0 && this->_report(result.epochs / this->_options.check_interval, result.error))
+				{
+					result.stopped = true;
+					break;
+				}
+			}
+			result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			return result;
+		}
+
+		bool _report(size_t checkpoint, value_type error)
+		{
+			std::lock_guard lock(this->_mutex);
+			auto& errors = this->_checkpoints[checkpoint];
+			errors.push_back(error);
+			if (errors.size() <= this->_options.min_reports)
+			{
+				return false;
+			}
+			auto sorted = errors;
+			const auto middle = sorted.begin() + sorted.size() / 2;
+			std::nth_element(sorted.begin(), middle, sorted.end());
+			return error > *middle * this->_options.stop_ratio;
+		}
+	};
+}
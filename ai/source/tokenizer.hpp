@@ -1,95 +1,240 @@
 #pragma once
 
 #include <string>
+#include <string_view>
 #include <list>
+#include <vector>
+#include <cstdint>
+#include <limits>
+#include <bit>
+#include <algorithm>
+#include <functional>
+#include <array>
+
+#if defined(__AVX2__) || defined(__AVX__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
 
 class string_tokenizer
 {
 public:
 	using string_type = std::string;
+	using view_type = std::string_view;
 	using array_type = std::list<string_type>;
+	using id_type = std::uint32_t;
+	static constexpr id_type npos = std::numeric_limits<id_type>::max();
 private:
-	array_type _tokens;
+	string_type _arena;
+	std::vector<size_t> _offsets{ 0 };
+	std::vector<size_t> _hashes;
+	std::vector<id_type> _slots;
 public:
-	array_type process(const string_type& input)
+	std::vector<id_type> process(view_type input)
+	{
+		std::vector<id_type> result;
+		for_each_token(input, [&](view_type token) {
+			result.push_back(this->insert(token));
+		});
+		return result;
+	}
+
+	id_type insert(view_type token)
 	{
-		const auto tokens = tokenize(input);
-		for (const auto& token : tokens)
+		const auto hash_value = hash(token);
+		if (const auto id = this->_find(token, hash_value); id != npos)
 		{
-			if (find(this->_tokens, hash(token)).empty())
-			{
-				this->_tokens.push_back(token);
-			}
+			return id;
+		}
+		if ((this->size() + 1) * 2 > this->_slots.size())
+		{
+			this->_rehash(std::max<size_t>(this->_slots.size() * 2, 16));
 		}
+		const auto id = (id_type)this->size();
+		this->_arena.append(token);
+		this->_offsets.push_back(this->_arena.size());
+		this->_hashes.push_back(hash_value);
+		this->_slots[this->_probe(hash_value)] = id;
+		return id;
+	}
+
+	id_type find(view_type token) const noexcept
+	{
+		return this->_find(token, hash(token));
 	}
 
-	string_type find_one(size_t hash_value)
+	view_type find_one(id_type id) const noexcept
 	{
-		return find(this->_tokens, hash_value);
+		if (id >= this->size())
+		{
+			return {};
+		}
+		return view_type(this->_arena).substr(this->_offsets[id], this->_offsets[id + 1] - this->_offsets[id]);
 	}
 
-	string_type find_all(std::vector<size_t> hash_values)
+	string_type find_all(const std::vector<id_type>& ids) const
 	{
 		string_type result;
-		for (const auto hash_value : hash_values)
+		for (const auto id : ids)
 		{
-			result += this->find_one(hash_value);
+			result += this->find_one(id);
 		}
 		return result;
 	}
+
+	void reserve(size_t count, size_t bytes = 0)
+	{
+		this->_offsets.reserve(count + 1);
+		this->_hashes.reserve(count);
+		this->_arena.reserve(bytes);
+		if (count * 2 > this->_slots.size())
+		{
+			this->_rehash(std::bit_ceil(count * 2));
+		}
+	}
+
+	size_t size() const noexcept
+	{
+		return this->_hashes.size();
+	}
 public:
-	static array_type tokenize(const string_type& input)
+	static array_type tokenize(view_type input)
 	{
 		array_type tokens;
-		string_type token;
-		for (auto value : input)
+		for_each_token(input, [&](view_type token) {
+			tokens.emplace_back(token);
+		});
+		return tokens;
+	}
+
+	static std::vector<view_type> tokenize_view(view_type input)
+	{
+		std::vector<view_type> tokens;
+		for_each_token(input, [&](view_type token) {
+			tokens.push_back(token);
+		});
+		return tokens;
+	}
+
+	template<typename function_type>
+	static void for_each_token(view_type input, function_type&& function)
+	{
+		const auto data = input.data();
+		const auto size = input.size();
+		size_t begin = 0, index = 0;
+		const auto split = [&](size_t position) {
+			if (position > begin)
+			{
+				function(input.substr(begin, position - begin));
+			}
+			function(input.substr(position, 1));
+			begin = position + 1;
+		};
+		for (; index + _block_size <= size; index += _block_size)
 		{
-			if (_is_space(value) || _is_punct(value) || _is_digit(value))
+			for (auto mask = _delimiter_mask(data + index); mask; mask &= mask - 1)
 			{
-				_push_and_clear(tokens, token);
-				_push(tokens, string_type(1, value));
+				split(index + std::countr_zero(mask));
 			}
-			else
+		}
+		for (; index != size; index++)
+		{
+			if (_is_delimiter(data[index]))
 			{
-				token.push_back(value);
+				split(index);
 			}
 		}
-		_push_and_clear(tokens, token);
-		return tokens;
+		if (size > begin)
+		{
+			function(input.substr(begin));
+		}
 	}
 
-	static size_t hash(const string_type& value)
+	static size_t hash(view_type value) noexcept
 	{
-		static const std::hash<string_type> hasher;
+		static const std::hash<view_type> hasher;
 		return hasher(value);
 	}
-
-	static string_type find(const array_type& tokens, size_t hash_value)
+private:
+	id_type _find(view_type token, size_t hash_value) const noexcept
 	{
-		for (const auto& token : tokens)
+		if (this->_slots.empty())
 		{
-			if (hash(token) == hash_value)
+			return npos;
+		}
+		const auto mask = this->_slots.size() - 1;
+		for (auto index = hash_value & mask; this->_slots[index] != npos; index = (index + 1) & mask)
+		{
+			const auto id = this->_slots[index];
+			if (this->_hashes[id] == hash_value && this->find_one(id) == token)
 			{
-				return token;
+				return id;
 			}
 		}
-		return {};
+		return npos;
 	}
-private:
-	static void _push_and_clear(array_type& array, string_type& value)
+
+	size_t _probe(size_t hash_value) const noexcept
 	{
-		if (!value.empty())
+		const auto mask = this->_slots.size() - 1;
+		auto index = hash_value & mask;
+		while (this->_slots[index] != npos)
 		{
-			_push(array, value);
-			value.clear();
+			index = (index + 1) & mask;
 		}
+		return index;
 	}
 
-	static void _push(array_type& array, const string_type& value)
+	void _rehash(size_t capacity)
 	{
-		array.push_back(value);
+		this->_slots.assign(capacity, npos);
+		for (id_type id = 0; id != this->size(); id++)
+		{
+			this->_slots[this->_probe(this->_hashes[id])] = id;
+		}
 	}
 
+#if defined(__AVX2__)
+	static constexpr size_t _block_size = 32;
+
+	static std::uint32_t _delimiter_mask(const char* data) noexcept
+	{
+		const auto lo_table = _mm256_setr_epi8(6, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 27, 27, 27, 26, 10, 6, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 27, 27, 27, 26, 10);
+		const auto hi_table = _mm256_setr_epi8(1, 0, 2, 2, 4, 8, 4, 16, 0, 0, 0, 0, 0, 0, 0, 0, 1, 0, 2, 2, 4, 8, 4, 16, 0, 0, 0, 0, 0, 0, 0, 0);
+		const auto nibble = _mm256_set1_epi8(0x0F);
+		const auto block = _mm256_loadu_si256((const __m256i*)data);
+		const auto lo = _mm256_shuffle_epi8(lo_table, _mm256_and_si256(block, nibble));
+		const auto hi = _mm256_shuffle_epi8(hi_table, _mm256_and_si256(_mm256_srli_epi16(block, 4), nibble));
+		const auto empty = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256());
+		return ~(std::uint32_t)_mm256_movemask_epi8(empty);
+	}
+#elif defined(__AVX__) || defined(__SSSE3__)
+	static constexpr size_t _block_size = 16;
+
+	static std::uint32_t _delimiter_mask(const char* data) noexcept
+	{
+		const auto lo_table = _mm_setr_epi8(6, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 27, 27, 27, 26, 10);
+		const auto hi_table = _mm_setr_epi8(1, 0, 2, 2, 4, 8, 4, 16, 0, 0, 0, 0, 0, 0, 0, 0);
+		const auto nibble = _mm_set1_epi8(0x0F);
+		const auto block = _mm_loadu_si128((const __m128i*)data);
+		const auto lo = _mm_shuffle_epi8(lo_table, _mm_and_si128(block, nibble));
+		const auto hi = _mm_shuffle_epi8(hi_table, _mm_and_si128(_mm_srli_epi16(block, 4), nibble));
+		const auto empty = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+		return ~(std::uint32_t)_mm_movemask_epi8(empty) & 0xFFFF;
+	}
+#else
+	static constexpr size_t _block_size = 8;
+
+	static std::uint32_t _delimiter_mask(const char* data) noexcept
+	{
+		std::uint32_t mask = 0;
+		for (size_t i = 0; i != _block_size; i++)
+		{
+			mask |= std::uint32_t(_is_delimiter(data[i])) << i;
+		}
+		return mask;
+	}
+#endif
+
 	static constexpr bool _is_space(const char value) noexcept
 	{
 		return value == ' ' || (value >= '\t' && value <= '\r');
@@ -104,4 +249,17 @@ private:
 	{
 		return value >= '0' && value <= '9';
 	}
+
+	static bool _is_delimiter(const char value) noexcept
+	{
+		static constexpr auto table = []() {
+			std::array<bool, 256> result{};
+			for (size_t i = 0; i != result.size(); i++)
+			{
+				result[i] = _is_space((char)i) || _is_punct((char)i) || _is_digit((char)i);
+			}
+			return result;
+		}();
+		return table[(unsigned char)value];
+	}
 };
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <numeric>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <cstdint>
+#include <cstring>
+#include "tokenizer.hpp"
+#include "mapped_file.hpp"
+
+class frozen_vocabulary
+{
+public:
+	using id_type = string_tokenizer::id_type;
+	static constexpr id_type npos = string_tokenizer::npos;
+	static constexpr size_t bucket_load = 4;
+	static constexpr std::uint32_t direct_slot = 0x80000000u;
+private:
+	struct _header
+	{
+		char magic[8];
+		std::uint32_t version;
+		std::uint32_t count;
+		std::uint32_t bucket_count;
+		std::uint32_t reserved;
+		std::uint64_t blob_size;
+	};
+
+	static constexpr char _magic[8]{ 'V', 'O', 'C', 'A', 'B', 'M', 'P', 'H' };
+	static constexpr std::uint32_t _version = 1;
+
+	mapped_file _file;
+	const _header* _info;
+	const std::uint32_t* _seeds;
+	const std::uint32_t* _slots;
+	const std::uint64_t* _offsets;
+	const char* _blob;
+public:
+	explicit frozen_vocabulary(const std::filesystem::path& path) : _file(path, mapped_file::access_kind::random)
+	{
+		const auto data = this->_file.data();
+		const auto size = this->_file.size();
+		this->_info = (const _header*)data;
+		if (size < sizeof(_header) || std::memcmp(this->_info->magic, _magic, sizeof(_magic)) != 0 || this->_info->version != _version)
+		{
+			throw std::runtime_error("invalid vocabulary file");
+		}
+		if (this->_info->count != 0 && this->_info->bucket_count == 0)
+		{
+			throw std::runtime_error("invalid vocabulary file");
+		}
+		const auto [seeds, slots, offsets, blob] = _layout(this->_info->count, this->_info->bucket_count);
+		if (size < blob || size - blob < this->_info->blob_size)
+		{
+			throw std::runtime_error("invalid vocabulary file");
+		}
+		this->_seeds = (const std::uint32_t*)(data + seeds);
+		this->_slots = (const std::uint32_t*)(data + slots);
+		this->_offsets = (const std::uint64_t*)(data + offsets);
+		this->_blob = data + blob;
+		if (this->_offsets[0] != 0 || this->_offsets[this->_info->count] > this->_info->blob_size || !std::is_sorted(this->_offsets, this->_offsets + this->_info->count + 1))
+		{
+			throw std::runtime_error("invalid vocabulary file");
+		}
+	}
+
+	id_type find(std::string_view token) const noexcept
+	{
+		const auto count = this->size();
+		if (count == 0)
+		{
+			return npos;
+		}
+		const auto hash_value = hash(token);
+		const auto seed = this->_seeds[_mix(hash_value, 0) % this->_info->bucket_count];
+		const auto id = this->_slots[(seed & direct_slot) ? (seed & ~direct_slot) % count : _mix(hash_value, seed) % count];
+		return (this->find_one(id) == token) ? id : npos;
+	}
+
+	std::string_view find_one(id_type id) const noexcept
+	{
+		if (id >= this->size())
+		{
+			return {};
+		}
+		return { this->_blob + this->_offsets[id], size_t(this->_offsets[id + 1] - this->_offsets[id]) };
+	}
+
+	std::string find_all(const std::vector<id_type>& ids) const
+	{
+		std::string result;
+		for (const auto id : ids)
+		{
+			result += this->find_one(id);
+		}
+		return result;
+	}
+
+	size_t size() const noexcept
+	{
+		return this->_info->count;
+	}
+
+	static void write(const string_tokenizer& tokens, const std::filesystem::path& path)
+	{
+		const auto count = (std::uint32_t)tokens.size();
+		const auto bucket_count = (std::uint32_t)std::max<size_t>((count + bucket_load - 1) / bucket_load, 1);
+
+		std::vector<std::uint64_t> hashes(count);
+		std::vector<std::vector<id_type>> buckets(bucket_count);
+		for (id_type id = 0; id != count; id++)
+		{
+			hashes[id] = hash(tokens.find_one(id));
+			buckets[_mix(hashes[id], 0) % bucket_count].push_back(id);
+		}
+		std::vector<std::uint32_t> order(bucket_count);
+		std::iota(order.begin(), order.end(), 0);
+		std::stable_sort(order.begin(), order.end(), [&](auto a, auto b) { return buckets[a].size() > buckets[b].size(); });
+
+		std::vector<std::uint32_t> seeds(bucket_count, 0), slots(count, npos);
+		std::vector<std::uint32_t> positions;
+		std::uint32_t free_slot = 0;
+		for (const auto bucket : order)
+		{
+			const auto& ids = buckets[bucket];
+			if (ids.empty())
+			{
+				break;
+			}
+			if (ids.size() == 1)
+			{
+				while (slots[free_slot] != npos) free_slot++;
+				slots[free_slot] = ids.front();
+				seeds[bucket] = direct_slot | free_slot;
+				continue;
+			}
+			bool placed = false;
+			for (std::uint32_t seed = 1; seed != direct_slot && !placed; seed++)
+			{
+				positions.clear();
+				for (const auto id : ids)
+				{
+					const auto position = (std::uint32_t)(_mix(hashes[id], seed) % count);
+					if (slots[position] != npos || std::find(positions.begin(), positions.end(), position) != positions.end())
+					{
+						break;
+					}
+					positions.push_back(position);
+				}
+				if (positions.size() == ids.size())
+				{
+					for (size_t i = 0; i != ids.size(); i++) slots[positions[i]] = ids[i];
+					seeds[bucket] = seed;
+					placed = true;
+				}
+			}
+			if (!placed)
+			{
+				throw std::runtime_error("cannot build vocabulary");
+			}
+		}
+
+		std::vector<std::uint64_t> offsets(count + 1, 0);
+		for (id_type id = 0; id != count; id++)
+		{
+			offsets[id + 1] = offsets[id] + tokens.find_one(id).size();
+		}
+
+		_header info{};
+		std::memcpy(info.magic, _magic, sizeof(_magic));
+		info.version = _version;
+		info.count = count;
+		info.bucket_count = bucket_count;
+		info.blob_size = offsets.back();
+
+		const auto [seeds_offset, slots_offset, offsets_offset, blob_offset] = _layout(count, bucket_count);
+		std::ofstream output_stream(path, std::ios::binary | std::ios::trunc);
+		if (!output_stream)
+		{
+			throw std::runtime_error("cannot open vocabulary file");
+		}
+		_write_at(output_stream, 0, &info, sizeof(info));
+		_write_at(output_stream, seeds_offset, seeds.data(), seeds.size() * sizeof(seeds[0]));
+		_write_at(output_stream, slots_offset, slots.data(), slots.size() * sizeof(slots[0]));
+		_write_at(output_stream, offsets_offset, offsets.data(), offsets.size() * sizeof(offsets[0]));
+		output_stream.seekp(blob_offset);
+		for (id_type id = 0; id != count; id++)
+		{
+			const auto token = tokens.find_one(id);
+			output_stream.write(token.data(), token.size());
+		}
+		if (!output_stream)
+		{
+			throw std::runtime_error("cannot write vocabulary file");
+		}
+	}
+
+	static constexpr std::uint64_t hash(std::string_view value) noexcept
+	{
+		auto result = 0xCBF29CE484222325ull;
+		for (const auto element : value)
+		{
+			result = (result ^ (unsigned char)element) * 0x100000001B3ull;
+		}
+		return result;
+	}
+private:
+	static constexpr std::uint64_t _mix(std::uint64_t hash_value, std::uint64_t seed) noexcept
+	{
+		auto result = hash_value ^ (seed * 0x9E3779B97F4A7C15ull);
+		result ^= result >> 33;
+		result *= 0xFF51AFD7ED558CCDull;
+		result ^= result >> 33;
+		result *= 0xC4CEB9FE1A85EC53ull;
+		return result ^ (result >> 33);
+	}
+
+	struct _sections
+	{
+		size_t seeds, slots, offsets, blob;
+	};
+
+	static constexpr _sections _layout(size_t count, size_t bucket_count) noexcept
+	{
+		_sections result{};
+		result.seeds = sizeof(_header);
+		result.slots = result.seeds + bucket_count * sizeof(std::uint32_t);
+		result.offsets = (result.slots + count * sizeof(std::uint32_t) + 7) & ~size_t(7);
+		result.blob = result.offsets + (count + 1) * sizeof(std::uint64_t);
+		return result;
+	}
+
+	static void _write_at(std::ostream& output_stream, size_t position, const void* data, size_t size)
+	{
+		output_stream.seekp(position);
+		output_stream.write((const char*)data, size);
+	}
+};
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <memory>
+#include <algorithm>
+
+class IoBuffer;
+
+//    ,    
+class BufferPool
+{
+public:
+	struct Block
+	{
+		BufferPool* pool = nullptr;
+		char* memory = nullptr;
+		Block* next = nullptr;
+		std::uint32_t references = 0;
+	};
+private:
+	struct Slab
+	{
+		std::unique_ptr<char[]> memory;
+		std::unique_ptr<Block[]> blocks;
+	};
+
+	size_t blockSize;
+	size_t blocksPerSlab;
+	std::vector<Slab> slabs;
+	std::map<const char*, size_t> ranges;
+	Block* freeList;
+	size_t freeCount;
+	Block* scratch;
+	size_t scratchUsed;
+public:
+	explicit BufferPool(size_t blockSize = 16 * 1024, size_t blocksPerSlab = 64) : blockSize(blockSize), blocksPerSlab(std::max<size_t>(blocksPerSlab, 1)), freeList(nullptr), freeCount(0), scratch(nullptr), scratchUsed(0)
+	{
+	}
+
+	BufferPool(const BufferPool&) = delete;
+	BufferPool& operator=(const BufferPool&) = delete;
+
+	//     
+	IoBuffer acquire();
+
+	//        ,  
+	void retain(const IoBuffer& part, std::vector<IoBuffer>& result);
+
+	void copy(std::string_view data, std::vector<IoBuffer>& result);
+
+	size_t size() const noexcept
+	{
+		return blockSize;
+	}
+
+	size_t available() const noexcept
+	{
+		return freeCount;
+	}
+
+	size_t allocated() const noexcept
+	{
+		return slabs.size() * blocksPerSlab;
+	}
+
+	void release(Block* block) noexcept
+	{
+		block->next = freeList;
+		freeList = block;
+		freeCount++;
+	}
+private:
+	Block* take()
+	{
+		if (!freeList)
+		{
+			grow();
+		}
+		const auto block = freeList;
+		freeList = block->next;
+		freeCount--;
+		block->next = nullptr;
+		block->references = 1;
+		return block;
+	}
+
+	void grow()
+	{
+		Slab slab{ std::make_unique<char[]>(blockSize * blocksPerSlab), std::make_unique<Block[]>(blocksPerSlab) };
+		for (size_t i = blocksPerSlab; i-- != 0;)
+		{
+			auto& block = slab.blocks[i];
+			block.pool = this;
+			block.memory = slab.memory.get() + i * blockSize;
+			release(&block);
+		}
+		ranges[slab.memory.get()] = slabs.size();
+		slabs.push_back(std::move(slab));
+	}
+
+	Block* owner(const char* pointer) const noexcept
+	{
+		auto iterator = ranges.upper_bound(pointer);
+		if (iterator == ranges.begin())
+		{
+			return nullptr;
+		}
+		--iterator;
+		const auto offset = (size_t)(pointer - iterator->first);
+		if (offset >= blockSize * blocksPerSlab)
+		{
+			return nullptr;
+		}
+		const auto block = &slabs[iterator->second].blocks[offset / blockSize];
+		return block->references ? block : nullptr;
+	}
+};
+
+//         
+class IoBuffer
+{
+private:
+	BufferPool::Block* block;
+	const char* pointer;
+	size_t length;
+	bool persistent;
+public:
+	IoBuffer() noexcept : block(nullptr), pointer(nullptr), length(0), persistent(false)
+	{
+	}
+
+	// persistent:     (,  )
+	explicit IoBuffer(std::string_view view, bool persistent = false) noexcept : block(nullptr), pointer(view.data()), length(view.size()), persistent(persistent)
+	{
+	}
+
+	IoBuffer(BufferPool::Block* block, const char* pointer, size_t length) noexcept : block(block), pointer(pointer), length(length), persistent(false)
+	{
+		if (block) block->references++;
+	}
+
+	IoBuffer(const IoBuffer& other) noexcept : IoBuffer(other.block, other.pointer, other.length)
+	{
+		persistent = other.persistent;
+	}
+
+	IoBuffer(IoBuffer&& other) noexcept : block(other.block), pointer(other.pointer), length(other.length), persistent(other.persistent)
+	{
+		other.block = nullptr;
+		other.pointer = nullptr;
+		other.length = 0;
+	}
+
+	IoBuffer& operator=(IoBuffer other) noexcept
+	{
+		std::swap(block, other.block);
+		std::swap(pointer, other.pointer);
+		std::swap(length, other.length);
+		std::swap(persistent, other.persistent);
+		return *this;
+	}
+
+	~IoBuffer()
+	{
+		if (block && --block->references == 0)
+		{
+			block->pool->release(block);
+		}
+	}
+
+	const char* data() const noexcept
+	{
+		return pointer;
+	}
+
+	//  ,     
+	char* writable() const noexcept
+	{
+		return const_cast<char*>(pointer);
+	}
+
+	size_t size() const noexcept
+	{
+		return length;
+	}
+
+	bool empty() const noexcept
+	{
+		return length == 0;
+	}
+
+	std::string_view view() const noexcept
+	{
+		return { pointer, length };
+	}
+
+	bool owning() const noexcept
+	{
+		return block || persistent;
+	}
+
+	bool unique() const noexcept
+	{
+		return block && block->references == 1;
+	}
+
+	IoBuffer slice(size_t offset, size_t count = std::string_view::npos) const noexcept
+	{
+		offset = std::min(offset, length);
+		IoBuffer result(block, pointer + offset, std::min(count, length - offset));
+		result.persistent = persistent;
+		return result;
+	}
+};
+
+inline IoBuffer BufferPool::acquire()
+{
+	const auto block = take();
+	IoBuffer result(block, block->memory, blockSize);
+	block->references--;
+	return result;
+}
+
+inline void BufferPool::retain(const IoBuffer& part, std::vector<IoBuffer>& result)
+{
+	if (part.empty())
+	{
+		return;
+	}
+	if (part.owning())
+	{
+		result.push_back(part);
+	}
+	else if (const auto block = owner(part.data()); block && part.data() + part.size() <= block->memory + blockSize)
+	{
+		result.emplace_back(block, part.data(), part.size());
+	}
+	else
+	{
+		copy(part.view(), result);
+	}
+}
+
+//       
+inline void BufferPool::copy(std::string_view data, std::vector<IoBuffer>& result)
+{
+	while (!data.empty())
+	{
+		if (!scratch || scratchUsed == blockSize)
+		{
+			if (scratch && --scratch->references == 0)
+			{
+				release(scratch);
+			}
+			scratch = take();
+			scratchUsed = 0;
+		}
+		const auto count = std::min(data.size(), blockSize - scratchUsed);
+		const auto target = scratch->memory + scratchUsed;
+		std::memcpy(target, data.data(), count);
+		result.emplace_back(scratch, target, count);
+		scratchUsed += count;
+		data.remove_prefix(count);
+	}
+}
+
+//      
+inline void consume(std::vector<IoBuffer>& parts, size_t bytes)
+{
+	size_t index = 0;
+	while (index != parts.size() && bytes >= parts[index].size())
+	{
+		bytes -= parts[index].size();
+		index++;
+	}
+	parts.erase(parts.begin(), parts.begin() + index);
+	if (bytes != 0 && !parts.empty())
+	{
+		parts.front() = parts.front().slice(bytes);
+	}
+}
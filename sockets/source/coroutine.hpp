@@ -0,0 +1,685 @@
+#pragma once
+
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+#include <memory>
+#include <deque>
+#include <vector>
+#include <iterator>
+#include <algorithm>
+#include <array>
+#include <span>
+#include <chrono>
+#include <cstring>
+#include <functional>
+#include <unordered_map>
+#include "reactor.hpp"
+
+//          
+class FramePool
+{
+private:
+	static constexpr size_t granularity = 64;
+	static constexpr size_t classes = 32;
+
+	struct Node
+	{
+		Node* next;
+	};
+
+	std::array<Node*, classes> lists{};
+public:
+	FramePool() = default;
+	FramePool(const FramePool&) = delete;
+	FramePool& operator=(const FramePool&) = delete;
+
+	~FramePool()
+	{
+		for (auto& list : lists)
+		{
+			while (list)
+			{
+				const auto node = list;
+				list = node->next;
+				::operator delete(node);
+			}
+		}
+	}
+
+	static FramePool& local()
+	{
+		thread_local FramePool pool;
+		return pool;
+	}
+
+	void* allocate(size_t size)
+	{
+		const auto index = (size + granularity - 1) / granularity;
+		if (index >= classes)
+		{
+			return ::operator new(size);
+		}
+		if (const auto node = lists[index])
+		{
+			lists[index] = node->next;
+			return node;
+		}
+		return ::operator new(index * granularity);
+	}
+
+	void deallocate(void* pointer, size_t size) noexcept
+	{
+		const auto index = (size + granularity - 1) / granularity;
+		if (index >= classes)
+		{
+			::operator delete(pointer);
+			return;
+		}
+		const auto node = (Node*)pointer;
+		node->next = lists[index];
+		lists[index] = node;
+	}
+};
+
+class TaskPromiseBase
+{
+public:
+	std::coroutine_handle<> continuation;
+	std::exception_ptr exception;
+	bool detached = false;
+
+	static void* operator new(size_t size)
+	{
+		return FramePool::local().allocate(size);
+	}
+
+	static void operator delete(void* pointer, size_t size) noexcept
+	{
+		FramePool::local().deallocate(pointer, size);
+	}
+
+	struct FinalAwaiter
+	{
+		bool await_ready() const noexcept
+		{
+			return false;
+		}
+
+		template<typename Promise>
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+		{
+			auto& promise = handle.promise();
+			if (!promise.detached)
+			{
+				return promise.continuation ? promise.continuation : std::noop_coroutine();
+			}
+			if (promise.exception)
+			{
+				report(promise.exception);
+			}
+			handle.destroy();
+			return std::noop_coroutine();
+		}
+
+		void await_resume() const noexcept
+		{
+		}
+	};
+
+	std::suspend_always initial_suspend() const noexcept
+	{
+		return {};
+	}
+
+	FinalAwaiter final_suspend() const noexcept
+	{
+		return {};
+	}
+
+	void unhandled_exception() noexcept
+	{
+		exception = std::current_exception();
+	}
+private:
+	//      onFailure 
+	static void report(const std::exception_ptr& exception) noexcept
+	{
+		const auto loop = EventLoop::current();
+		try
+		{
+			std::rethrow_exception(exception);
+		}
+		catch (const std::exception& error)
+		{
+			if (loop) loop->report(error.what());
+		}
+		catch (...)
+		{
+			if (loop) loop->report(" ");
+		}
+	}
+};
+
+template<typename T>
+class TaskResult
+{
+protected:
+	std::optional<T> value;
+public:
+	template<typename U>
+	void return_value(U&& result)
+	{
+		value.emplace(std::forward<U>(result));
+	}
+
+	T take()
+	{
+		return std::move(*value);
+	}
+};
+
+template<>
+class TaskResult<void>
+{
+public:
+	void return_void() const noexcept
+	{
+	}
+
+	void take() const noexcept
+	{
+	}
+};
+
+//  :   co_await  spawn
+template<typename T = void>
+class Task
+{
+public:
+	struct promise_type : TaskPromiseBase, TaskResult<T>
+	{
+		Task get_return_object() noexcept
+		{
+			return Task(std::coroutine_handle<promise_type>::from_promise(*this));
+		}
+	};
+
+	struct Awaiter
+	{
+		std::coroutine_handle<promise_type> handle;
+
+		bool await_ready() const noexcept
+		{
+			return !handle || handle.done();
+		}
+
+		std::coroutine_handle<> await_suspend(std::coroutine_handle<> awaiting) noexcept
+		{
+			handle.promise().continuation = awaiting;
+			return handle;
+		}
+
+		T await_resume()
+		{
+			if (handle.promise().exception)
+			{
+				std::rethrow_exception(handle.promise().exception);
+			}
+			return handle.promise().take();
+		}
+	};
+private:
+	std::coroutine_handle<promise_type> handle;
+public:
+	Task() noexcept = default;
+
+	explicit Task(std::coroutine_handle<promise_type> handle) noexcept : handle(handle)
+	{
+	}
+
+	Task(Task&& other) noexcept : handle(std::exchange(other.handle, {}))
+	{
+	}
+
+	Task& operator=(Task&& other) noexcept
+	{
+		if (this != &other)
+		{
+			if (handle) handle.destroy();
+			handle = std::exchange(other.handle, {});
+		}
+		return *this;
+	}
+
+	~Task()
+	{
+		if (handle) handle.destroy();
+	}
+
+	Awaiter operator co_await() && noexcept
+	{
+		return { handle };
+	}
+
+	std::coroutine_handle<promise_type> release() noexcept
+	{
+		return std::exchange(handle, {});
+	}
+};
+
+//   ,    
+inline void spawn(Task<> task)
+{
+	const auto handle = task.release();
+	if (handle)
+	{
+		handle.promise().detached = true;
+		handle.resume();
+	}
+}
+
+struct Sleep
+{
+	std::chrono::milliseconds delay;
+
+	bool await_ready() const noexcept
+	{
+		return delay.count() <= 0 || !EventLoop::current();
+	}
+
+	void await_suspend(std::coroutine_handle<> handle) const
+	{
+		EventLoop::current()->schedule(delay, [handle]() { handle.resume(); });
+	}
+
+	void await_resume() const noexcept
+	{
+	}
+};
+
+inline Sleep sleepFor(std::chrono::milliseconds delay) noexcept
+{
+	return { delay };
+}
+
+//  ,     ,    
+struct StreamState
+{
+	EventLoop& loop;
+	Connection* connection;
+	std::deque<IoBuffer> inbox;
+	size_t available = 0;
+	//  limit   inbox      , 0 
+	size_t limit;
+	std::coroutine_handle<> reader;
+	std::coroutine_handle<> writer;
+
+	StreamState(EventLoop& loop, Connection& connection, size_t limit) noexcept : loop(loop), connection(&connection), limit(limit)
+	{
+	}
+
+	// ,    ,        
+	void received(const IoBuffer& data)
+	{
+		if (data.owning())
+		{
+			inbox.push_back(data);
+		}
+		else
+		{
+			std::vector<IoBuffer> parts;
+			loop.buffers().retain(data, parts);
+			std::move(parts.begin(), parts.end(), std::back_inserter(inbox));
+		}
+		available += data.size();
+	}
+
+	void consumed(size_t count)
+	{
+		available -= count;
+		if (connection && connection->held && available <= limit / 2)
+		{
+			loop.release(*connection);
+		}
+	}
+
+	static void wake(std::coroutine_handle<>& handle)
+	{
+		if (handle) std::exchange(handle, {}).resume();
+	}
+};
+
+class Stream
+{
+private:
+	std::shared_ptr<StreamState> state;
+
+	struct Waitable
+	{
+		StreamState& state;
+
+		bool await_ready() const noexcept
+		{
+			return !state.inbox.empty() || !state.connection;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) noexcept
+		{
+			state.reader = handle;
+		}
+
+		bool await_resume() const noexcept
+		{
+			return !state.inbox.empty();
+		}
+	};
+
+	struct Readable : Waitable
+	{
+		IoBuffer await_resume()
+		{
+			if (this->state.inbox.empty())
+			{
+				return {};
+			}
+			auto result = std::move(this->state.inbox.front());
+			this->state.inbox.pop_front();
+			this->state.consumed(result.size());
+			return result;
+		}
+	};
+
+	//  :   std::nullopt,    
+	struct TimedReadable : Readable
+	{
+		std::shared_ptr<StreamState> owner;
+		std::chrono::milliseconds timeout;
+		std::uint64_t timer = 0;
+
+		void await_suspend(std::coroutine_handle<> handle)
+		{
+			this->state.reader = handle;
+			timer = this->state.loop.schedule(timeout, [owner = owner]() { StreamState::wake(owner->reader); });
+		}
+
+		std::optional<IoBuffer> await_resume()
+		{
+			if (timer)
+			{
+				this->state.loop.cancel(timer);
+			}
+			if (this->state.inbox.empty() && this->state.connection)
+			{
+				return std::nullopt;
+			}
+			return Readable::await_resume();
+		}
+	};
+
+	// ,       highWatermark
+	struct Writable
+	{
+		StreamState& state;
+
+		bool await_ready() const noexcept
+		{
+			return !state.connection || !state.connection->congested;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) noexcept
+		{
+			state.writer = handle;
+		}
+
+		bool await_resume() const noexcept
+		{
+			return state.connection != nullptr;
+		}
+	};
+public:
+	Stream() noexcept = default;
+
+	explicit Stream(std::shared_ptr<StreamState> state) noexcept : state(std::move(state))
+	{
+	}
+
+	// Stream  :   -  
+	Stream(const Stream&) = delete;
+	Stream& operator=(const Stream&) = delete;
+	Stream(Stream&&) noexcept = default;
+
+	Stream& operator=(Stream&& other) noexcept
+	{
+		if (this != &other)
+		{
+			close();
+			state = std::move(other.state);
+		}
+		return *this;
+	}
+
+	~Stream()
+	{
+		close();
+	}
+
+	explicit operator bool() const noexcept
+	{
+		return state != nullptr;
+	}
+
+	bool open() const noexcept
+	{
+		return state && state->connection;
+	}
+
+	int fd() const noexcept
+	{
+		return open() ? state->connection->fd : -1;
+	}
+
+	size_t available() const noexcept
+	{
+		return state ? state->available : 0;
+	}
+
+	//     ,    
+	Readable readSome() noexcept
+	{
+		return { { *state } };
+	}
+
+	TimedReadable readSome(std::chrono::milliseconds timeout) noexcept
+	{
+		return { { { *state } }, state, timeout };
+	}
+
+	Task<bool> readExact(std::span<char> target)
+	{
+		auto& stream = *state;
+		size_t filled = 0;
+		while (filled != target.size())
+		{
+			if (!co_await Waitable{ stream })
+			{
+				co_return false;
+			}
+			auto& front = stream.inbox.front();
+			const auto count = std::min(front.size(), target.size() - filled);
+			std::memcpy(target.data() + filled, front.data(), count);
+			filled += count;
+			if (count == front.size())
+			{
+				stream.inbox.pop_front();
+			}
+			else
+			{
+				front = front.slice(count);
+			}
+			stream.consumed(count);
+		}
+		co_return true;
+	}
+
+	Writable writeAll(std::span<const IoBuffer> parts)
+	{
+		if (state->connection)
+		{
+			state->loop.send(*state->connection, parts);
+		}
+		return { *state };
+	}
+
+	Writable writeAll(std::string_view data)
+	{
+		const IoBuffer part(data);
+		return writeAll(std::span(&part, 1));
+	}
+
+	void close()
+	{
+		if (state && state->connection)
+		{
+			state->loop.close(*state->connection);
+		}
+	}
+};
+
+class Acceptor
+{
+private:
+	std::deque<Stream> pending;
+	std::coroutine_handle<> waiter;
+	bool stopped = false;
+
+	struct Acceptable
+	{
+		Acceptor& acceptor;
+
+		bool await_ready() const noexcept
+		{
+			return !acceptor.pending.empty() || acceptor.stopped;
+		}
+
+		void await_suspend(std::coroutine_handle<> handle) noexcept
+		{
+			acceptor.waiter = handle;
+		}
+
+		Stream await_resume()
+		{
+			if (acceptor.pending.empty())
+			{
+				return {};
+			}
+			auto result = std::move(acceptor.pending.front());
+			acceptor.pending.pop_front();
+			return result;
+		}
+	};
+public:
+	//  Stream   
+	Acceptable accept() noexcept
+	{
+		return { *this };
+	}
+
+	void push(Stream stream)
+	{
+		pending.push_back(std::move(stream));
+		StreamState::wake(waiter);
+	}
+
+	void stop()
+	{
+		stopped = true;
+		StreamState::wake(waiter);
+	}
+};
+
+//  ,     
+class CoroutineHandler : public IEventHandler
+{
+public:
+	using Listener = std::function<Task<>(Acceptor&)>;
+private:
+	Listener listener;
+	std::function<void(const std::string&)> failure;
+	EventLoop* loop;
+	size_t inboxLimit;
+	Acceptor acceptor;
+	std::unordered_map<std::uint64_t, std::shared_ptr<StreamState>> streams;
+public:
+	CoroutineHandler(Listener listener, std::function<void(const std::string&)> failure, size_t inboxLimit = 1024 * 1024) : listener(std::move(listener)), failure(std::move(failure)), loop(nullptr), inboxLimit(inboxLimit)
+	{
+	}
+
+	void bind(EventLoop& eventLoop) noexcept
+	{
+		loop = &eventLoop;
+	}
+
+	void onStart() override
+	{
+		spawn(listener(acceptor));
+	}
+
+	void onStop() override
+	{
+		acceptor.stop();
+	}
+
+	void onAccept(Connection& connection) override
+	{
+		auto state = std::make_shared<StreamState>(*loop, connection, inboxLimit);
+		streams.emplace(connection.id, state);
+		acceptor.push(Stream(std::move(state)));
+	}
+
+	void onData(Connection& connection, const IoBuffer& data) override
+	{
+		const auto iterator = streams.find(connection.id);
+		if (iterator == streams.end())
+		{
+			return;
+		}
+		const auto state = iterator->second;
+		state->received(data);
+		StreamState::wake(state->reader);
+		//     :   
+		if (state->connection && state->limit && state->available > state->limit)
+		{
+			loop->hold(connection);
+		}
+	}
+
+	void onDrain(Connection& connection) override
+	{
+		const auto iterator = streams.find(connection.id);
+		if (iterator != streams.end())
+		{
+			StreamState::wake(iterator->second->writer);
+		}
+	}
+
+	void onClose(Connection& connection) override
+	{
+		const auto iterator = streams.find(connection.id);
+		if (iterator == streams.end())
+		{
+			return;
+		}
+		const auto state = std::move(iterator->second);
+		streams.erase(iterator);
+		state->connection = nullptr;
+		StreamState::wake(state->reader);
+		StreamState::wake(state->writer);
+	}
+
+	void onFailure(const std::string& message) override
+	{
+		failure(message);
+	}
+};
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include "reactor.hpp"
+
+class EpollEngine : public IEventEngine
+{
+private:
+	IEventSink& sink;
+	int epollFd;
+	int listenSocket;
+	int wakeFd;
+	std::vector<epoll_event> events;
+public:
+	explicit EpollEngine(IEventSink& sink, size_t maxEvents = 1024) : sink(sink), epollFd(epoll_create1(EPOLL_CLOEXEC)), listenSocket(-1), wakeFd(-1), events(maxEvents)
+	{
+		if (epollFd == -1)
+		{
+			throw std::system_error(errno, std::generic_category(), "epoll_create1");
+		}
+	}
+
+	~EpollEngine() override
+	{
+		::close(epollFd);
+	}
+
+	void listen(int socket) override
+	{
+		listenSocket = socket;
+		setNonBlocking(socket);
+		epoll_event event{ .events = EPOLLIN | EPOLLET, .data = { .ptr = nullptr } };
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, socket, &event) == -1)
+		{
+			sink.onFailure(" epoll_ctl()");
+		}
+	}
+
+	void unlisten() override
+	{
+		if (listenSocket != -1)
+		{
+			epoll_ctl(epollFd, EPOLL_CTL_DEL, listenSocket, nullptr);
+			listenSocket = -1;
+		}
+	}
+
+	void watch(int fd) override
+	{
+		wakeFd = fd;
+		epoll_event event{ .events = EPOLLIN | EPOLLET, .data = { .ptr = &wakeFd } };
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event) == -1)
+		{
+			sink.onFailure(" epoll_ctl()");
+		}
+	}
+
+	void attach(Connection& connection) override
+	{
+		setNonBlocking(connection.fd);
+		const int enable = 1;
+		setsockopt(connection.fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+		epoll_event event{ .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data = { .ptr = &connection } };
+		if (epoll_ctl(epollFd, EPOLL_CTL_ADD, connection.fd, &event) == -1)
+		{
+			sink.onFailure(" epoll_ctl()");
+		}
+	}
+
+	void detach(Connection& connection) override
+	{
+		epoll_ctl(epollFd, EPOLL_CTL_DEL, connection.fd, nullptr);
+		::close(connection.fd);
+	}
+
+	size_t write(Connection& connection, std::span<const IoBuffer> parts) override
+	{
+		size_t total = 0;
+		size_t index = 0;
+		size_t offset = 0;
+		while (index != parts.size())
+		{
+			iovec vectors[64];
+			size_t count = 0;
+			for (auto i = index; i != parts.size() && count != std::size(vectors); i++)
+			{
+				const auto skip = (i == index) ? offset : 0;
+				vectors[count++] = { (void*)(parts[i].data() + skip), parts[i].size() - skip };
+			}
+			msghdr message{};
+			message.msg_iov = vectors;
+			message.msg_iovlen = count;
+			const auto sent = ::sendmsg(connection.fd, &message, MSG_NOSIGNAL);
+			if (sent > 0)
+			{
+				total += (size_t)sent;
+				auto rest = (size_t)sent;
+				while (index != parts.size() && rest >= parts[index].size() - offset)
+				{
+					rest -= parts[index].size() - offset;
+					offset = 0;
+					index++;
+				}
+				offset += rest;
+			}
+			else if (sent == -1 && errno == EINTR)
+			{
+				continue;
+			}
+			else
+			{
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+				{
+					sink.onClosed(connection);
+				}
+				break;
+			}
+		}
+		return total;
+	}
+
+	//     EPOLLOUT,     attach
+	void flush(Connection&) override
+	{
+	}
+
+	void pause(Connection&) override
+	{
+	}
+
+	//      ,     
+	void resume(Connection& connection) override
+	{
+		epoll_event event{ .events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET, .data = { .ptr = &connection } };
+		epoll_ctl(epollFd, EPOLL_CTL_MOD, connection.fd, &event);
+	}
+
+	void poll(int timeout) override
+	{
+		const auto count = epoll_wait(epollFd, events.data(), (int)events.size(), timeout);
+		if (count == -1 && errno != EINTR)
+		{
+			sink.onFailure(" epoll_wait()");
+		}
+		for (int i = 0; i < count; i++)
+		{
+			const auto& event = events[i];
+			if (!event.data.ptr)
+			{
+				if (listenSocket != -1) acceptAll();
+				continue;
+			}
+			if (event.data.ptr == &wakeFd)
+			{
+				std::uint64_t value;
+				[[maybe_unused]] const auto count = ::read(wakeFd, &value, sizeof(value));
+				sink.onWake();
+				continue;
+			}
+			auto& connection = *(Connection*)event.data.ptr;
+			if (event.events & EPOLLOUT)
+			{
+				writeQueued(connection);
+			}
+			if (event.events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR))
+			{
+				receiveAll(connection);
+			}
+		}
+	}
+private:
+	static void setNonBlocking(int fd) noexcept
+	{
+		fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+	}
+
+	void acceptAll()
+	{
+		while (true)
+		{
+			const auto client = accept4(listenSocket, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+			if (client != -1)
+			{
+				sink.onAccepted(client);
+			}
+			else if (errno == EINTR || errno == ECONNABORTED)
+			{
+				continue;
+			}
+			else
+			{
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+				{
+					sink.onFailure(" accept()");
+				}
+				break;
+			}
+		}
+	}
+
+	void writeQueued(Connection& connection)
+	{
+		if (connection.closing || connection.output.empty())
+		{
+			return;
+		}
+		if (const auto written = write(connection, connection.output))
+		{
+			sink.onWritten(connection, written);
+		}
+	}
+
+	void receiveAll(Connection& connection)
+	{
+		auto& pool = sink.buffers();
+		while (!connection.closing && !connection.paused)
+		{
+			//          
+			const auto chunk = pool.acquire();
+			const auto received = ::recv(connection.fd, chunk.writable(), chunk.size(), 0);
+			if (received > 0)
+			{
+				sink.onReceived(connection, chunk.slice(0, (size_t)received));
+			}
+			else if (received == 0)
+			{
+				sink.onClosed(connection); //   
+			}
+			else if (errno == EINTR)
+			{
+				continue;
+			}
+			else
+			{
+				if (errno != EAGAIN && errno != EWOULDBLOCK)
+				{
+					sink.onFailure(" recv()");
+					sink.onClosed(connection);
+				}
+				break;
+			}
+		}
+	}
+};
@@ -0,0 +1,289 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <span>
+#include <limits>
+#include <utility>
+#include <iterator>
+#include <algorithm>
+#include "buffer.hpp"
+
+enum class FrameMode
+{
+	None,
+	Length,
+	Delimiter
+};
+
+// Length: 4   (big-endian)  , Delimiter:   
+struct FrameOptions
+{
+	FrameMode mode = FrameMode::None;
+	char delimiter = '\n';
+	size_t maxFrame = 1024 * 1024;
+};
+
+//      ,      
+class FrameDecoder
+{
+private:
+	static constexpr size_t header = 4;
+
+	FrameOptions options;
+	std::vector<char> partial;
+	size_t expected;
+public:
+	explicit FrameDecoder(const FrameOptions& options = {}) : options(options), expected(0)
+	{
+	}
+
+	bool enabled() const noexcept
+	{
+		return options.mode != FrameMode::None;
+	}
+
+	// deliver(const IoBuffer&) -> bool: false  ; false  feed -   maxFrame
+	template<typename Function>
+	bool feed(const IoBuffer& chunk, Function&& deliver)
+	{
+		const auto data = chunk.data();
+		const auto size = chunk.size();
+		size_t offset = 0;
+		if (!partial.empty())
+		{
+			const auto taken = resume(data, size, deliver);
+			if (taken == std::numeric_limits<size_t>::max())
+			{
+				return false;
+			}
+			if (taken == 0 && !partial.empty())
+			{
+				return true;
+			}
+			offset = taken;
+		}
+		while (offset != size)
+		{
+			size_t begin = 0;
+			size_t length = 0;
+			size_t end = 0;
+			if (options.mode == FrameMode::Length)
+			{
+				if (size - offset < header)
+				{
+					break;
+				}
+				length = decode(data + offset);
+				if (length > options.maxFrame)
+				{
+					return false;
+				}
+				begin = offset + header;
+				end = begin + length;
+				if (end > size)
+				{
+					break;
+				}
+			}
+			else
+			{
+				const auto found = (const char*)std::memchr(data + offset, options.delimiter, size - offset);
+				if (!found)
+				{
+					break;
+				}
+				begin = offset;
+				length = (size_t)(found - data) - offset;
+				end = begin + length + 1;
+			}
+			offset = end;
+			if (!deliver(chunk.slice(begin, length)))
+			{
+				return true;
+			}
+		}
+		if (offset != size)
+		{
+			if (size - offset > options.maxFrame + header)
+			{
+				return false;
+			}
+			partial.assign(data + offset, data + size);
+			expected = (options.mode == FrameMode::Length && partial.size() >= header) ? header + decode(partial.data()) : 0;
+			if (options.mode == FrameMode::Length && expected > options.maxFrame + header)
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	static void encode(std::uint32_t length, char* target) noexcept
+	{
+		target[0] = (char)(length >> 24);
+		target[1] = (char)(length >> 16);
+		target[2] = (char)(length >> 8);
+		target[3] = (char)length;
+	}
+private:
+	static size_t decode(const char* source) noexcept
+	{
+		const auto bytes = (const unsigned char*)source;
+		return ((size_t)bytes[0] << 24) | ((size_t)bytes[1] << 16) | ((size_t)bytes[2] << 8) | bytes[3];
+	}
+
+	//   ;    , 0     
+	template<typename Function>
+	size_t resume(const char* data, size_t size, Function&& deliver)
+	{
+		size_t taken = 0;
+		if (options.mode == FrameMode::Length)
+		{
+			while (taken != size)
+			{
+				const auto target = expected ? expected : header;
+				const auto count = std::min(target - partial.size(), size - taken);
+				partial.insert(partial.end(), data + taken, data + taken + count);
+				taken += count;
+				if (!expected && partial.size() == header)
+				{
+					expected = header + decode(partial.data());
+					if (expected > options.maxFrame + header)
+					{
+						return std::numeric_limits<size_t>::max();
+					}
+				}
+				if (expected && partial.size() == expected)
+				{
+					break;
+				}
+			}
+			if (!expected || partial.size() != expected)
+			{
+				return 0;
+			}
+			finish(header, deliver);
+			return taken;
+		}
+
+		const auto found = (const char*)std::memchr(data, options.delimiter, size);
+		const auto count = found ? (size_t)(found - data) : size;
+		if (partial.size() + count > options.maxFrame)
+		{
+			return std::numeric_limits<size_t>::max();
+		}
+		partial.insert(partial.end(), data, data + count);
+		if (!found)
+		{
+			return 0;
+		}
+		finish(0, deliver);
+		return count + 1;
+	}
+
+	template<typename Function>
+	void finish(size_t skip, Function&& deliver)
+	{
+		const IoBuffer frame(std::string_view(partial.data() + skip, partial.size() - skip));
+		deliver(frame);
+		partial.clear();
+		expected = 0;
+	}
+};
+
+//         
+class Pipeline
+{
+public:
+	static constexpr std::uint64_t none = std::numeric_limits<std::uint64_t>::max();
+private:
+	struct Pending
+	{
+		std::vector<IoBuffer> parts;
+		bool complete = false;
+	};
+
+	std::uint64_t issued;
+	std::uint64_t head;
+	std::uint64_t active;
+	bool deferred;
+	std::map<std::uint64_t, Pending> waiting;
+public:
+	Pipeline() noexcept : issued(0), head(0), active(none), deferred(false)
+	{
+	}
+
+	void begin() noexcept
+	{
+		active = issued++;
+		deferred = false;
+	}
+
+	void end(std::vector<IoBuffer>& out)
+	{
+		const auto ticket = std::exchange(active, none);
+		if (!deferred)
+		{
+			complete(ticket, out);
+		}
+	}
+
+	//        reply
+	std::uint64_t defer() noexcept
+	{
+		deferred = true;
+		return active;
+	}
+
+	std::uint64_t current() const noexcept
+	{
+		return active;
+	}
+
+	size_t pending() const noexcept
+	{
+		return (size_t)(issued - head);
+	}
+
+	void output(std::uint64_t ticket, std::span<const IoBuffer> parts, BufferPool& pool, std::vector<IoBuffer>& out)
+	{
+		if (ticket < head || ticket >= issued)
+		{
+			return;
+		}
+		auto& target = (ticket == head) ? out : waiting[ticket].parts;
+		for (const auto& part : parts)
+		{
+			pool.retain(part, target);
+		}
+	}
+
+	void complete(std::uint64_t ticket, std::vector<IoBuffer>& out)
+	{
+		if (ticket < head || ticket >= issued)
+		{
+			return;
+		}
+		if (ticket != head)
+		{
+			waiting[ticket].complete = true;
+			return;
+		}
+		head++;
+		for (auto iterator = waiting.find(head); iterator != waiting.end() && iterator->first == head; iterator = waiting.find(head))
+		{
+			auto& pending = iterator->second;
+			std::move(pending.parts.begin(), pending.parts.end(), std::back_inserter(out));
+			if (!pending.complete)
+			{
+				pending.parts.clear();
+				break;
+			}
+			waiting.erase(iterator);
+			head++;
+		}
+	}
+};
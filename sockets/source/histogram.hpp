@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+#include <bit>
+#include <limits>
+#include <algorithm>
+
+//    HDR:     64  ,    1/64 (~1,6%)
+class LatencyHistogram
+{
+private:
+	static constexpr unsigned subBits = 7;
+	static constexpr std::uint64_t subCount = std::uint64_t(1) << subBits;
+	static constexpr std::uint64_t halfCount = subCount / 2;
+
+	std::vector<std::uint64_t> counts;
+	std::uint64_t total;
+	std::uint64_t minimum;
+	std::uint64_t maximum;
+	long double sum;
+public:
+	// highest:   ,     
+	explicit LatencyHistogram(std::uint64_t highest = std::uint64_t(1) << 40) : counts(index(highest) + 1), total(0), minimum(std::numeric_limits<std::uint64_t>::max()), maximum(0), sum(0)
+	{
+	}
+
+	void record(std::uint64_t value, std::uint64_t count = 1) noexcept
+	{
+		const auto slot = std::min<size_t>(index(value), counts.size() - 1);
+		counts[slot] += count;
+		total += count;
+		minimum = std::min(minimum, value);
+		maximum = std::max(maximum, value);
+		sum += (long double)value * count;
+	}
+
+	void merge(const LatencyHistogram& other)
+	{
+		if (other.counts.size() > counts.size())
+		{
+			counts.resize(other.counts.size());
+		}
+		for (size_t i = 0; i != other.counts.size(); i++)
+		{
+			counts[i] += other.counts[i];
+		}
+		total += other.total;
+		minimum = std::min(minimum, other.minimum);
+		maximum = std::max(maximum, other.maximum);
+		sum += other.sum;
+	}
+
+	std::uint64_t count() const noexcept
+	{
+		return total;
+	}
+
+	std::uint64_t min() const noexcept
+	{
+		return total ? minimum : 0;
+	}
+
+	std::uint64_t max() const noexcept
+	{
+		return maximum;
+	}
+
+	double mean() const noexcept
+	{
+		return total ? (double)(sum / total) : 0.0;
+	}
+
+	// ,    percent   (  )
+	std::uint64_t percentile(double percent) const noexcept
+	{
+		if (total == 0)
+		{
+			return 0;
+		}
+		const auto rank = std::max<std::uint64_t>((std::uint64_t)((percent / 100.0) * total + 0.5), 1);
+		std::uint64_t seen = 0;
+		for (size_t i = 0; i != counts.size(); i++)
+		{
+			seen += counts[i];
+			if (seen >= rank)
+			{
+				return std::clamp(highest(i), minimum, maximum);
+			}
+		}
+		return maximum;
+	}
+private:
+	static size_t index(std::uint64_t value) noexcept
+	{
+		if (value < subCount)
+		{
+			return (size_t)value;
+		}
+		const auto shift = (unsigned)std::bit_width(value) - subBits;
+		return (size_t)(subCount + (shift - 1) * halfCount + ((value >> shift) - halfCount));
+	}
+
+	static std::uint64_t highest(size_t slot) noexcept
+	{
+		if (slot < subCount)
+		{
+			return slot;
+		}
+		const auto shift = (unsigned)((slot - subCount) / halfCount) + 1;
+		const auto base = (std::uint64_t)((slot - subCount) % halfCount) + halfCount;
+		return ((base + 1) << shift) - 1;
+	}
+};
@@ -0,0 +1,348 @@
+//          (sockets <port> <engine> <loops> callbacks lines)
+#include <cstdio>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <charconv>
+#include <memory>
+#include <algorithm>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <unistd.h>
+#include "histogram.hpp"
+
+using Clock = std::chrono::steady_clock;
+
+struct LoadOptions
+{
+	std::string host = "127.0.0.1";
+	int port = 8080;
+	size_t connections = 64;
+	size_t threads = 1;
+	double duration = 10.0;
+	//      , 0 -    pipeline   
+	double rate = 0.0;
+	size_t size = 64;
+	size_t pipeline = 1;
+};
+
+struct LoadResult
+{
+	LatencyHistogram latency;
+	std::uint64_t requests = 0;
+	std::uint64_t bytes = 0;
+	std::uint64_t errors = 0;
+};
+
+class LoadWorker
+{
+private:
+	struct Session
+	{
+		int fd = -1;
+		//       :       
+		std::deque<Clock::time_point> inflight;
+		std::string outgoing;
+		size_t written = 0;
+		Clock::time_point next;
+		bool connected = false;
+	};
+
+	const LoadOptions& options;
+	std::vector<Session> sessions;
+	std::string request;
+	int epollFd;
+	Clock::duration interval;
+	LoadResult result;
+public:
+	LoadWorker(const LoadOptions& options, size_t count, size_t first) : options(options), sessions(count), request(options.size, 'x'), epollFd(epoll_create1(EPOLL_CLOEXEC)), interval(0)
+	{
+		request.push_back('\n');
+		if (options.rate > 0)
+		{
+			interval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.connections / options.rate));
+		}
+		const auto start = Clock::now();
+		for (size_t i = 0; i != sessions.size(); i++)
+		{
+			//     ,    
+			sessions[i].next = start + interval * (first + i) / options.connections;
+		}
+	}
+
+	~LoadWorker()
+	{
+		for (auto& session : sessions)
+		{
+			if (session.fd >= 0) close(session.fd);
+		}
+		close(epollFd);
+	}
+
+	const LoadResult& outcome() const noexcept
+	{
+		return result;
+	}
+
+	void run()
+	{
+		for (auto& session : sessions)
+		{
+			open(session);
+		}
+		const auto end = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration));
+		std::vector<epoll_event> events(256);
+		while (true)
+		{
+			const auto now = Clock::now();
+			if (now >= end)
+			{
+				break;
+			}
+			auto wake = end;
+			for (auto& session : sessions)
+			{
+				if (session.fd < 0 || !session.connected)
+				{
+					continue;
+				}
+				if (options.rate > 0)
+				{
+					while (session.next <= now)
+					{
+						enqueue(session, session.next);
+						session.next += interval;
+					}
+					wake = std::min(wake, session.next);
+				}
+				else
+				{
+					while (session.inflight.size() < options.pipeline)
+					{
+						enqueue(session, now);
+					}
+				}
+				flush(session);
+			}
+
+			const auto delay = std::chrono::duration_cast<std::chrono::nanoseconds>(std::max(wake - Clock::now(), Clock::duration::zero()));
+			const timespec timeout{ (time_t)(delay.count() / 1000000000), (long)(delay.count() % 1000000000) };
+			const auto count = epoll_pwait2(epollFd, events.data(), (int)events.size(), &timeout, nullptr);
+			for (int i = 0; i < count; i++)
+			{
+				auto& session = sessions[events[i].data.u64];
+				if (events[i].events & (EPOLLERR | EPOLLHUP))
+				{
+					fail(session);
+					continue;
+				}
+				if (events[i].events & EPOLLOUT)
+				{
+					session.connected = true;
+					flush(session);
+				}
+				if (events[i].events & EPOLLIN)
+				{
+					receive(session);
+				}
+			}
+		}
+	}
+private:
+	void open(Session& session)
+	{
+		session.fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+		const int enable = 1;
+		setsockopt(session.fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+		sockaddr_in address{};
+		address.sin_family = AF_INET;
+		address.sin_port = htons(options.port);
+		inet_pton(AF_INET, options.host.c_str(), &address.sin_addr);
+		if (connect(session.fd, (sockaddr*)&address, sizeof(address)) != 0 && errno != EINPROGRESS)
+		{
+			fail(session);
+			return;
+		}
+		epoll_event event{};
+		event.events = EPOLLIN | EPOLLOUT | EPOLLET;
+		event.data.u64 = (std::uint64_t)(&session - sessions.data());
+		epoll_ctl(epollFd, EPOLL_CTL_ADD, session.fd, &event);
+	}
+
+	void fail(Session& session)
+	{
+		if (session.fd < 0)
+		{
+			return;
+		}
+		result.errors++;
+		close(session.fd);
+		session.fd = -1;
+		session.inflight.clear();
+	}
+
+	void enqueue(Session& session, Clock::time_point planned)
+	{
+		session.inflight.push_back(planned);
+		session.outgoing += request;
+	}
+
+	void flush(Session& session)
+	{
+		while (session.fd >= 0 && session.written != session.outgoing.size())
+		{
+			const auto sent = ::send(session.fd, session.outgoing.data() + session.written, session.outgoing.size() - session.written, MSG_NOSIGNAL);
+			if (sent <= 0)
+			{
+				if (sent < 0 && errno != EAGAIN && errno != EWOULDBLOCK)
+				{
+					fail(session);
+				}
+				break;
+			}
+			session.written += (size_t)sent;
+		}
+		if (session.written == session.outgoing.size())
+		{
+			session.outgoing.clear();
+			session.written = 0;
+		}
+	}
+
+	void receive(Session& session)
+	{
+		char chunk[64 * 1024];
+		while (session.fd >= 0)
+		{
+			const auto received = recv(session.fd, chunk, sizeof(chunk), 0);
+			if (received <= 0)
+			{
+				if (received == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+				{
+					fail(session);
+				}
+				break;
+			}
+			result.bytes += (size_t)received;
+			const auto now = Clock::now();
+			std::string_view data(chunk, (size_t)received);
+			while (!data.empty())
+			{
+				const auto end = data.find('\n');
+				if (end == std::string_view::npos)
+				{
+					break;
+				}
+				data.remove_prefix(end + 1);
+				if (!session.inflight.empty())
+				{
+					result.latency.record((std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(now - session.inflight.front()).count());
+					session.inflight.pop_front();
+					result.requests++;
+				}
+			}
+		}
+	}
+};
+
+static void print(const LoadOptions& options, const LoadResult& result, double elapsed)
+{
+	const auto micros = [&](double percent) { return result.latency.percentile(percent) / 1000.0; };
+	std::printf("{\n");
+	std::printf("  \"connections\": %zu,\n  \"threads\": %zu,\n  \"mode\": \"%s\",\n", options.connections, options.threads, options.rate > 0 ? "open" : "closed");
+	std::printf("  \"target_rps\": %.0f,\n  \"duration_s\": %.3f,\n", options.rate, elapsed);
+	std::printf("  \"requests\": %llu,\n  \"errors\": %llu,\n", (unsigned long long)result.requests, (unsigned long long)result.errors);
+	std::printf("  \"throughput_rps\": %.1f,\n  \"throughput_mbps\": %.3f,\n", result.requests / elapsed, result.bytes * 8.0 / elapsed / 1e6);
+	std::printf("  \"latency_us\": {\n");
+	std::printf("    \"min\": %.1f,\n    \"mean\": %.1f,\n", result.latency.min() / 1000.0, result.latency.mean() / 1000.0);
+	std::printf("    \"p50\": %.1f,\n    \"p90\": %.1f,\n    \"p99\": %.1f,\n    \"p99.9\": %.1f,\n", micros(50), micros(90), micros(99), micros(99.9));
+	std::printf("    \"max\": %.1f\n  }\n}\n", result.latency.max() / 1000.0);
+}
+
+template<typename T>
+static bool parse(std::string_view text, T& value)
+{
+	const auto [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+	return error == std::errc() && end == text.data() + text.size();
+}
+
+static void usage(const char* program)
+{
+	std::cerr << ": " << program << " [--host ] [--port ] [--connections N] [--threads N] [--duration ] [--rate /] [--size ] [--pipeline N]" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+	LoadOptions options;
+	//    -,      
+	if (argc % 2 == 0)
+	{
+		std::cerr << "  " << argv[argc - 1] << std::endl;
+		usage(argv[0]);
+		return 1;
+	}
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		const std::string_view key(argv[i]);
+		const std::string_view value(argv[i + 1]);
+		auto valid = true;
+		if (key == "--host") options.host = value;
+		else if (key == "--port") valid = parse(value, options.port);
+		else if (key == "--connections") valid = parse(value, options.connections);
+		else if (key == "--threads") valid = parse(value, options.threads);
+		else if (key == "--duration") valid = parse(value, options.duration);
+		else if (key == "--rate") valid = parse(value, options.rate);
+		else if (key == "--size") valid = parse(value, options.size);
+		else if (key == "--pipeline") valid = parse(value, options.pipeline);
+		else valid = false;
+		if (!valid)
+		{
+			std::cerr << "  " << key << " " << value << std::endl;
+			usage(argv[0]);
+			return 1;
+		}
+	}
+	options.threads = std::clamp<size_t>(options.threads, 1, std::max<size_t>(options.connections, 1));
+	options.pipeline = std::max<size_t>(options.pipeline, 1);
+
+	//        ,   
+	std::vector<std::unique_ptr<LoadWorker>> workers;
+	size_t first = 0;
+	for (size_t i = 0; i != options.threads; i++)
+	{
+		const auto count = options.connections / options.threads + (i < options.connections % options.threads ? 1 : 0);
+		workers.push_back(std::make_unique<LoadWorker>(options, count, first));
+		first += count;
+	}
+	const auto started = Clock::now();
+	std::vector<std::thread> threads;
+	for (auto& worker : workers)
+	{
+		threads.emplace_back([&worker]() { worker->run(); });
+	}
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	const auto elapsed = std::chrono::duration<double>(Clock::now() - started).count();
+	LoadResult total;
+	for (auto& worker : workers)
+	{
+		const auto& result = worker->outcome();
+		total.latency.merge(result.latency);
+		total.requests += result.requests;
+		total.bytes += result.bytes;
+		total.errors += result.errors;
+	}
+	print(options, total, elapsed);
+	return 0;
+}
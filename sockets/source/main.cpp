@@ -1,11 +1,85 @@
 #include "main.hpp"
 
+#ifndef _WIN32
+Task<> echo(Stream stream)
+{
+	while (true)
+	{
+		const auto data = co_await stream.readSome();
+		if (data.empty())
+		{
+			break;
+		}
+		const IoBuffer reply[]{ IoBuffer("Echo: ", true), data };
+		if (!co_await stream.writeAll(reply))
+		{
+			break;
+		}
+	}
+}
+
+Task<> acceptEcho(Acceptor& acceptor)
+{
+	while (auto stream = co_await acceptor.accept())
+	{
+		spawn(echo(std::move(stream)));
+	}
+}
+#endif
 
-int main()
+// sockets <port> <epoll|uring|udp> <loops> <callbacks|coroutines|gso> <none|lines|length> < >
+int main(int argc, char* argv[])
 {
 	setlocale(LC_ALL, "");
 
+	const auto port = (argc > 1) ? std::atoi(argv[1]) : 8080;
+#ifdef _WIN32
+	AsyncTcpServer server;
+	server.start(port);
+#else
+	ServerOptions options;
+	if (argc > 2 && std::string_view(argv[2]) == "uring")
+	{
+		options.engine = EngineKind::Uring;
+	}
+	if (argc > 3)
+	{
+		options.loops = (size_t)std::max(std::atoi(argv[3]), 1);
+	}
+	if (argc > 5)
+	{
+		const std::string_view framing(argv[5]);
+		options.framing.mode = (framing == "lines") ? FrameMode::Delimiter : (framing == "length") ? FrameMode::Length : FrameMode::None;
+	}
+	if (argc > 6)
+	{
+		options.statsPort = std::atoi(argv[6]);
+	}
+
+	if (argc > 2 && std::string_view(argv[2]) == "udp")
+	{
+		UdpOptions udpOptions;
+		udpOptions.loops = options.loops;
+		udpOptions.gro = udpOptions.gso = (argc > 4 && std::string_view(argv[4]) == "gso");
+		UdpServer server(udpOptions);
+		server.start(port);
+		std::cin.get();
+		server.stop();
+		return 0;
+	}
 
+	AsyncTcpServer server(options);
+	if (argc > 4 && std::string_view(argv[4]) == "coroutines")
+	{
+		server.serve(port, acceptEcho);
+	}
+	else
+	{
+		server.start(port);
+	}
+#endif
+	std::cin.get();
+	server.stop();
 
 	return 0;
 }
@@ -14,9 +14,30 @@
 #include <execution>
 #include <valarray>
 #include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <unordered_map>
+#include <string_view>
 
+#ifdef _WIN32
 #include <windows.h>
 #pragma comment(lib, "ws2_32")
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#include <unistd.h>
+
+using SOCKET = int;
+using SOCKADDR = sockaddr;
+constexpr SOCKET INVALID_SOCKET = -1;
+constexpr int SOCKET_ERROR = -1;
+
+inline int closesocket(SOCKET socket)
+{
+	return ::close(socket);
+}
+#endif
 
 class AsyncSocketAPI
 {
@@ -26,7 +47,7 @@ public:
 	virtual void stop() = 0;
 
 	// 
-	virtual void onReceive(const std::string& data, SOCKET client) = 0;
+	virtual void onReceive(std::string_view data, SOCKET client) = 0;
 	virtual void onSend(size_t bytes, SOCKET client) = 0;
 	virtual void onError(const std::string& msg) = 0;
 };
@@ -47,6 +68,7 @@ void check_code(const int code)
 	}
 }
 
+#ifdef _WIN32
 class WindowsSocket
 {
 public:
@@ -65,9 +87,20 @@ public:
 class AsyncTcpServer : public AsyncSocketAPI, public WindowsSocket
 {
 private:
+	struct Client
+	{
+		SOCKET socket = INVALID_SOCKET;
+		std::thread thread;
+	};
+
 	std::atomic<bool> running;
 	SOCKET listenSocket;
 	std::thread worker;
+	//        stop,  onReceive    
+	std::mutex clientsLock;
+	std::unordered_map<std::uint64_t, Client> clients;
+	std::vector<std::uint64_t> finished;
+	std::uint64_t nextClient = 0;
 public:
 	AsyncTcpServer() : running(false), listenSocket(INVALID_SOCKET)
 	{
@@ -112,8 +145,26 @@ public:
 	void stop() override
 	{
 		running = false;
-		if (worker.joinable()) worker.join();
+		//     select,   
 		if (listenSocket != INVALID_SOCKET) closesocket(listenSocket);
+		listenSocket = INVALID_SOCKET;
+		if (worker.joinable()) worker.join();
+
+		std::vector<std::thread> threads;
+		{
+			std::lock_guard lock(clientsLock);
+			for (auto& [id, client] : clients)
+			{
+				if (client.socket != INVALID_SOCKET) shutdown(client.socket, SD_BOTH);
+				threads.push_back(std::move(client.thread));
+			}
+			clients.clear();
+			finished.clear();
+		}
+		for (auto& thread : threads)
+		{
+			if (thread.joinable()) thread.join();
+		}
 	}
 
 protected:
@@ -122,6 +173,7 @@ protected:
 		fd_set readfds;
 		while (running)
 		{
+			reap();
 			FD_ZERO(&readfds);
 			FD_SET(listenSocket, &readfds);
 
@@ -135,14 +187,18 @@ protected:
 				SOCKET client = accept(listenSocket, nullptr, nullptr);
 				if (client != INVALID_SOCKET)
 				{
-					std::thread([this, client]() {
+					std::lock_guard lock(clientsLock);
+					const auto id = nextClient++;
+					auto& entry = clients[id];
+					entry.socket = client;
+					entry.thread = std::thread([this, client, id]() {
 						char buffer[1024];
 						while (true)
 						{
 							int n = recv(client, buffer, sizeof(buffer), 0);
 							if (n > 0)
 							{
-								onReceive(std::string(buffer, n), client);
+								onReceive(std::string_view(buffer, n), client);
 							}
 							else if (n == 0)
 							{
@@ -150,24 +206,52 @@ protected:
 							}
 							else
 							{
-								onError(" recv()");
+								if (running) onError(" recv()");
 								break;
 							}
 						}
+						std::lock_guard lock(clientsLock);
+						const auto iterator = clients.find(id);
+						if (iterator != clients.end())
+						{
+							iterator->second.socket = INVALID_SOCKET;
+							finished.push_back(id);
+						}
 						closesocket(client);
-					}).detach();
+					});
 				}
 			}
 		}
 	}
 
+	void reap()
+	{
+		std::vector<std::thread> threads;
+		{
+			std::lock_guard lock(clientsLock);
+			for (const auto id : finished)
+			{
+				const auto iterator = clients.find(id);
+				if (iterator == clients.end()) continue;
+				threads.push_back(std::move(iterator->second.thread));
+				clients.erase(iterator);
+			}
+			finished.clear();
+		}
+		for (auto& thread : threads)
+		{
+			if (thread.joinable()) thread.join();
+		}
+	}
+
 	//  
-	void onReceive(const std::string& data, SOCKET client) override
+	void onReceive(std::string_view data, SOCKET client) override
 	{
 		std::cout << ": " << data << std::endl;
-		std::string reply = "Echo: " + data;
-		int sent = send(client, reply.c_str(), (int)reply.size(), 0);
-		if (sent > 0) onSend(sent, client);
+		char prefix[] = "Echo: ";
+		WSABUF reply[]{ { (ULONG)(sizeof(prefix) - 1), prefix }, { (ULONG)data.size(), (CHAR*)data.data() } };
+		DWORD sent = 0;
+		if (WSASend(client, reply, 2, &sent, 0, nullptr, nullptr) == 0 && sent > 0) onSend(sent, client);
 	}
 
 	void onSend(size_t bytes, SOCKET) override
@@ -180,3 +264,7 @@ protected:
 		std::cerr << ": " << msg << std::endl;
 	}
 };
+#else
+#include "server.hpp"
+#include "udp.hpp"
+#endif
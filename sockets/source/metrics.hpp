@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <array>
+#include <bit>
+#include <string>
+#include <vector>
+#include <utility>
+#include <algorithm>
+
+//     : load + store   ,   relaxed-
+class Counter
+{
+private:
+	std::atomic<std::uint64_t> value{ 0 };
+public:
+	void add(std::uint64_t count = 1) noexcept
+	{
+		value.store(value.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+	}
+
+	void subtract(std::uint64_t count) noexcept
+	{
+		const auto current = value.load(std::memory_order_relaxed);
+		value.store(current - std::min(current, count), std::memory_order_relaxed);
+	}
+
+	void set(std::uint64_t count) noexcept
+	{
+		value.store(count, std::memory_order_relaxed);
+	}
+
+	std::uint64_t load() const noexcept
+	{
+		return value.load(std::memory_order_relaxed);
+	}
+};
+
+//    8  ( ~12%)     
+class TimeHistogram
+{
+public:
+	static constexpr unsigned subBits = 3;
+	static constexpr size_t subCount = size_t(1) << subBits;
+	static constexpr size_t buckets = (64 - subBits + 1) * subCount;
+private:
+	std::array<Counter, buckets> counts;
+public:
+	void record(std::uint64_t nanoseconds) noexcept
+	{
+		counts[index(nanoseconds)].add();
+	}
+
+	void mergeInto(std::array<std::uint64_t, buckets>& target) const noexcept
+	{
+		for (size_t i = 0; i != buckets; i++)
+		{
+			target[i] += counts[i].load();
+		}
+	}
+
+	static size_t index(std::uint64_t value) noexcept
+	{
+		if (value < subCount)
+		{
+			return (size_t)value;
+		}
+		const auto shift = (unsigned)std::bit_width(value) - subBits - 1;
+		return (size_t)((shift + 1) * subCount + ((value >> shift) - subCount));
+	}
+
+	static std::uint64_t highest(size_t slot) noexcept
+	{
+		if (slot < subCount)
+		{
+			return slot;
+		}
+		const auto shift = (unsigned)(slot / subCount) - 1;
+		const auto base = (std::uint64_t)(slot % subCount) + subCount;
+		return ((base + 1) << shift) - 1;
+	}
+};
+
+//      -,       
+struct alignas(64) LoopMetrics
+{
+	Counter accepted;
+	Counter closed;
+	Counter connections;
+	Counter bytesIn;
+	Counter bytesOut;
+	Counter messages;
+	Counter errors;
+	Counter queuedBytes;
+	Counter paused;
+	Counter timers;
+	Counter tasks;
+	TimeHistogram handlerTime;
+};
+
+//    ,   
+struct MetricsSnapshot
+{
+	struct Loop
+	{
+		std::uint64_t accepted = 0;
+		std::uint64_t closed = 0;
+		std::uint64_t connections = 0;
+		std::uint64_t bytesIn = 0;
+		std::uint64_t bytesOut = 0;
+		std::uint64_t messages = 0;
+		std::uint64_t errors = 0;
+		std::uint64_t queuedBytes = 0;
+		std::uint64_t paused = 0;
+		std::uint64_t timers = 0;
+		std::uint64_t tasks = 0;
+	};
+
+	std::vector<Loop> loops;
+	std::array<std::uint64_t, TimeHistogram::buckets> handlerTime{};
+
+	void add(const LoopMetrics& metrics)
+	{
+		loops.push_back({ metrics.accepted.load(), metrics.closed.load(), metrics.connections.load(), metrics.bytesIn.load(), metrics.bytesOut.load(),
+			metrics.messages.load(), metrics.errors.load(), metrics.queuedBytes.load(), metrics.paused.load(), metrics.timers.load(), metrics.tasks.load() });
+		metrics.handlerTime.mergeInto(handlerTime);
+	}
+
+	std::uint64_t percentile(double percent) const noexcept
+	{
+		std::uint64_t total = 0;
+		for (const auto count : handlerTime)
+		{
+			total += count;
+		}
+		if (total == 0)
+		{
+			return 0;
+		}
+		const auto rank = std::max<std::uint64_t>((std::uint64_t)((percent / 100.0) * total + 0.5), 1);
+		std::uint64_t seen = 0;
+		for (size_t i = 0; i != handlerTime.size(); i++)
+		{
+			seen += handlerTime[i];
+			if (seen >= rank)
+			{
+				return TimeHistogram::highest(i);
+			}
+		}
+		return 0;
+	}
+
+	//   Prometheus:    ,  loop   
+	std::string text() const
+	{
+		std::string result;
+		const auto counter = [&](const char* name, const char* type, std::uint64_t Loop::* field) {
+			result += "# TYPE sockets_";
+			result += name;
+			result += ' ';
+			result += type;
+			result += '\n';
+			std::uint64_t sum = 0;
+			for (size_t i = 0; i != loops.size(); i++)
+			{
+				result += "sockets_" + std::string(name) + "{loop=\"" + std::to_string(i) + "\"} " + std::to_string(loops[i].*field) + '\n';
+				sum += loops[i].*field;
+			}
+			result += "sockets_" + std::string(name) + " " + std::to_string(sum) + '\n';
+		};
+		counter("accepted_total", "counter", &Loop::accepted);
+		counter("closed_total", "counter", &Loop::closed);
+		counter("connections", "gauge", &Loop::connections);
+		counter("received_bytes_total", "counter", &Loop::bytesIn);
+		counter("sent_bytes_total", "counter", &Loop::bytesOut);
+		counter("messages_total", "counter", &Loop::messages);
+		counter("errors_total", "counter", &Loop::errors);
+		counter("queued_bytes", "gauge", &Loop::queuedBytes);
+		counter("paused_connections", "gauge", &Loop::paused);
+		counter("timers", "gauge", &Loop::timers);
+		counter("tasks_total", "counter", &Loop::tasks);
+
+		result += "# TYPE sockets_handler_seconds summary\n";
+		for (const auto& [label, percent] : { std::pair{ "0.5", 50.0 }, std::pair{ "0.99", 99.0 }, std::pair{ "0.999", 99.9 } })
+		{
+			char value[32];
+			std::snprintf(value, sizeof(value), "%.9g", percentile(percent) / 1e9);
+			result += "sockets_handler_seconds{quantile=\"" + std::string(label) + "\"} " + value + '\n';
+		}
+		std::uint64_t count = 0;
+		for (const auto value : handlerTime)
+		{
+			count += value;
+		}
+		result += "sockets_handler_seconds_count " + std::to_string(count) + '\n';
+		return result;
+	}
+};
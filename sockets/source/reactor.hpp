@@ -0,0 +1,681 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <unordered_map>
+#include <atomic>
+#include <span>
+#include <algorithm>
+#include <chrono>
+#include <functional>
+#include <system_error>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#include "buffer.hpp"
+#include "framing.hpp"
+#include "timer.hpp"
+#include "metrics.hpp"
+#include "tasks.hpp"
+
+struct Connection
+{
+	int fd = -1;
+	std::uint64_t id = 0;
+	bool closing = false;
+	bool paused = false;
+	bool congested = false;
+	//   ,     
+	bool held = false;
+	size_t queued = 0;
+	std::uint64_t idleTimer = 0;
+	std::uint64_t activity = 0;
+	std::vector<IoBuffer> output;
+	FrameDecoder decoder;
+	Pipeline pipeline;
+	//        
+	std::vector<IoBuffer> replies;
+};
+
+class EventLoop;
+
+//  ,      ; id   fd
+struct ConnectionRef
+{
+	EventLoop* loop = nullptr;
+	int fd = -1;
+	std::uint64_t id = 0;
+
+	explicit operator bool() const noexcept
+	{
+		return loop != nullptr;
+	}
+};
+
+//    
+class IEventHandler
+{
+public:
+	virtual void onStart() = 0;
+	virtual void onStop() = 0;
+	virtual void onAccept(Connection& connection) = 0;
+	virtual void onData(Connection& connection, const IoBuffer& data) = 0;
+	virtual void onDrain(Connection& connection) = 0;
+	virtual void onClose(Connection& connection) = 0;
+	virtual void onFailure(const std::string& message) = 0;
+};
+
+//    
+class IEventSink
+{
+public:
+	virtual void onAccepted(int fd) = 0;
+	virtual void onReceived(Connection& connection, const IoBuffer& data) = 0;
+	virtual void onWritten(Connection& connection, size_t bytes) = 0;
+	virtual void onClosed(Connection& connection) = 0;
+	virtual void onFailure(const std::string& message) = 0;
+	//    watch,    
+	virtual void onWake() = 0;
+	virtual BufferPool& buffers() = 0;
+};
+
+class IEventEngine
+{
+public:
+	virtual ~IEventEngine() = default;
+
+	virtual void listen(int listenSocket) = 0;
+	//     ,     
+	virtual void unlisten() = 0;
+	// eventfd      
+	virtual void watch(int wakeFd) = 0;
+	virtual void attach(Connection& connection) = 0;
+	virtual void detach(Connection& connection) = 0;
+	//    ,    
+	virtual size_t write(Connection& connection, std::span<const IoBuffer> parts) = 0;
+	//   connection.output,    onWritten
+	virtual void flush(Connection& connection) = 0;
+	virtual void pause(Connection& connection) = 0;
+	virtual void resume(Connection& connection) = 0;
+	virtual void poll(int timeout) = 0;
+};
+
+class EventLoop : private IEventSink
+{
+private:
+	IEventHandler& handler;
+	BufferPool pool;
+	std::unique_ptr<IEventEngine> engine;
+	std::unordered_map<int, std::unique_ptr<Connection>> connections;
+	std::vector<std::unique_ptr<Connection>> closed;
+	std::uint64_t nextId;
+	std::atomic<bool> running;
+	int wakeFd;
+	std::atomic<bool> notified;
+	std::atomic<bool> drainRequested;
+	std::atomic<std::int64_t> drainTimeout;
+	bool draining;
+	TaskQueue tasks;
+	size_t lowWatermark;
+	size_t highWatermark;
+	FrameOptions frameOptions;
+	LoopMetrics metrics;
+
+	using Clock = std::chrono::steady_clock;
+
+	TimerWheel timers;
+	Clock::time_point started;
+	std::chrono::milliseconds idle;
+
+	static inline thread_local EventLoop* active = nullptr;
+public:
+	template<typename Engine, typename... Args>
+	static std::unique_ptr<EventLoop> create(IEventHandler& handler, Args&&... args)
+	{
+		auto loop = std::unique_ptr<EventLoop>(new EventLoop(handler));
+		loop->engine = std::make_unique<Engine>(static_cast<IEventSink&>(*loop), std::forward<Args>(args)...);
+		loop->engine->watch(loop->wakeFd);
+		return loop;
+	}
+
+	~EventLoop()
+	{
+		closeAll();
+		engine.reset();
+		::close(wakeFd);
+	}
+
+	void listen(int listenSocket)
+	{
+		engine->listen(listenSocket);
+	}
+
+	void run()
+	{
+		active = this;
+		handler.onStart();
+		while (running)
+		{
+			engine->poll(timeout());
+			expire();
+			metrics.timers.set(timers.size());
+			closed.clear();
+			if (draining && connections.empty())
+			{
+				running = false;
+			}
+		}
+		closeAll();
+		handler.onStop();
+		active = nullptr;
+	}
+
+	// ,     
+	static EventLoop* current() noexcept
+	{
+		return active;
+	}
+
+	//    ,   
+	void stop() noexcept
+	{
+		running = false;
+		wake();
+	}
+
+	//  ,     ;   timeout  
+	void drain(std::chrono::milliseconds timeout) noexcept
+	{
+		drainTimeout = timeout.count();
+		drainRequested = true;
+		wake();
+	}
+
+	//   :     
+	void post(std::function<void()> task)
+	{
+		tasks.push(std::move(task));
+		wake();
+	}
+
+	//   :        ,   
+	void post(const ConnectionRef& target, std::string data)
+	{
+		post([this, target, data = std::move(data)]() {
+			if (const auto connection = find(target))
+			{
+				send(*connection, data);
+			}
+		});
+	}
+
+	//     ,   
+	void post(const ConnectionRef& target, std::uint64_t ticket, std::string data)
+	{
+		post([this, target, ticket, data = std::move(data)]() {
+			if (const auto connection = find(target))
+			{
+				const IoBuffer part(data);
+				reply(*connection, ticket, std::span(&part, 1));
+			}
+		});
+	}
+
+	ConnectionRef reference(const Connection& connection) noexcept
+	{
+		return { this, connection.fd, connection.id };
+	}
+
+	//   eventfd      
+	void wake() noexcept
+	{
+		if (!notified.exchange(true))
+		{
+			const std::uint64_t one = 1;
+			[[maybe_unused]] const auto written = ::write(wakeFd, &one, sizeof(one));
+		}
+	}
+
+	//     
+	std::uint64_t schedule(std::chrono::milliseconds delay, std::function<void()> callback)
+	{
+		return timers.schedule(ticks(delay) + lag(), std::move(callback));
+	}
+
+	//       
+	bool rearm(std::uint64_t timer, std::chrono::milliseconds delay)
+	{
+		return timers.rearm(timer, ticks(delay) + lag());
+	}
+
+	bool cancel(std::uint64_t timer)
+	{
+		return timers.cancel(timer);
+	}
+
+	void report(const std::string& message)
+	{
+		metrics.errors.add();
+		handler.onFailure(message);
+	}
+
+	//    
+	const LoopMetrics& stats() const noexcept
+	{
+		return metrics;
+	}
+
+	//  onData          
+	size_t send(Connection& connection, std::span<const IoBuffer> parts)
+	{
+		if (connection.closing)
+		{
+			return 0;
+		}
+		if (connection.pipeline.current() != Pipeline::none)
+		{
+			connection.pipeline.output(connection.pipeline.current(), parts, pool, connection.replies);
+			return total(parts);
+		}
+		return transmit(connection, parts);
+	}
+
+	size_t send(Connection& connection, std::string_view data)
+	{
+		const IoBuffer part(data);
+		return send(connection, std::span(&part, 1));
+	}
+
+	//         reply,    
+	std::uint64_t defer(Connection& connection) noexcept
+	{
+		return connection.pipeline.defer();
+	}
+
+	size_t reply(Connection& connection, std::uint64_t ticket, std::span<const IoBuffer> parts)
+	{
+		if (connection.closing)
+		{
+			return 0;
+		}
+		connection.pipeline.output(ticket, parts, pool, connection.replies);
+		connection.pipeline.complete(ticket, connection.replies);
+		flushReplies(connection);
+		settle(connection);
+		return total(parts);
+	}
+
+	void close(Connection& connection)
+	{
+		if (connection.closing)
+		{
+			return;
+		}
+		connection.closing = true;
+		metrics.closed.add();
+		metrics.connections.subtract(1);
+		metrics.queuedBytes.subtract(connection.queued);
+		if (connection.paused)
+		{
+			metrics.paused.subtract(1);
+		}
+		if (connection.idleTimer)
+		{
+			cancel(connection.idleTimer);
+		}
+		engine->detach(connection);
+		handler.onClose(connection);
+
+		const auto iterator = connections.find(connection.fd);
+		if (iterator != connections.end() && iterator->second.get() == &connection)
+		{
+			closed.push_back(std::move(iterator->second));
+			connections.erase(iterator);
+		}
+	}
+
+	Connection* find(int fd) noexcept
+	{
+		const auto iterator = connections.find(fd);
+		return (iterator != connections.end()) ? iterator->second.get() : nullptr;
+	}
+
+	Connection* find(const ConnectionRef& target) noexcept
+	{
+		const auto connection = find(target.fd);
+		return (connection && connection->id == target.id && !connection->closing) ? connection : nullptr;
+	}
+
+	size_t size() const noexcept
+	{
+		return connections.size();
+	}
+
+	//    high    low   , 0 
+	void watermarks(size_t low, size_t high) noexcept
+	{
+		lowWatermark = std::min(low, high);
+		highWatermark = high;
+	}
+
+	//     ,    
+	void hold(Connection& connection)
+	{
+		if (connection.closing || connection.held)
+		{
+			return;
+		}
+		connection.held = true;
+		if (!connection.paused)
+		{
+			connection.paused = true;
+			metrics.paused.add();
+			engine->pause(connection);
+		}
+	}
+
+	void release(Connection& connection)
+	{
+		if (connection.closing || !connection.held)
+		{
+			return;
+		}
+		connection.held = false;
+		if (connection.paused && !(connection.congested && connection.queued > lowWatermark))
+		{
+			connection.paused = false;
+			metrics.paused.subtract(1);
+			engine->resume(connection);
+		}
+	}
+
+	//      timeout , 0 
+	void idleTimeout(std::chrono::milliseconds timeout) noexcept
+	{
+		idle = timeout;
+	}
+
+	//        
+	void framing(const FrameOptions& options)
+	{
+		frameOptions = options;
+	}
+private:
+	explicit EventLoop(IEventHandler& handler) : handler(handler), nextId(1), running(true), wakeFd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC)), notified(false), drainRequested(false), drainTimeout(0), draining(false), lowWatermark(64 * 1024), highWatermark(1024 * 1024), frameOptions(), started(Clock::now()), idle(0)
+	{
+		if (wakeFd == -1)
+		{
+			throw std::system_error(errno, std::generic_category(), "eventfd");
+		}
+	}
+
+	//    ,    ;      
+	size_t transmit(Connection& connection, std::span<const IoBuffer> parts)
+	{
+		const auto size = total(parts);
+		auto written = connection.output.empty() ? engine->write(connection, parts) : 0;
+		metrics.bytesOut.add(written);
+		if (written == size || connection.closing)
+		{
+			return written;
+		}
+
+		for (const auto& part : parts)
+		{
+			if (written >= part.size())
+			{
+				written -= part.size();
+				continue;
+			}
+			connection.queued += part.size() - written;
+			metrics.queuedBytes.add(part.size() - written);
+			pool.retain(part.slice(written), connection.output);
+			written = 0;
+		}
+		engine->flush(connection);
+
+		//     :    
+		if (highWatermark && connection.queued >= highWatermark)
+		{
+			connection.congested = true;
+			if (!connection.paused)
+			{
+				connection.paused = true;
+				metrics.paused.add();
+				engine->pause(connection);
+			}
+		}
+		return size;
+	}
+
+	void flushReplies(Connection& connection)
+	{
+		if (!connection.replies.empty() && !connection.closing)
+		{
+			transmit(connection, connection.replies);
+		}
+		connection.replies.clear();
+	}
+
+	static size_t total(std::span<const IoBuffer> parts) noexcept
+	{
+		size_t result = 0;
+		for (const auto& part : parts)
+		{
+			result += part.size();
+		}
+		return result;
+	}
+
+	int timeout() const
+	{
+		return (int)timers.timeout(1000);
+	}
+
+	void expire()
+	{
+		timers.advance(elapsed());
+	}
+
+	std::uint64_t elapsed() const noexcept
+	{
+		return (std::uint64_t)std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - started).count();
+	}
+
+	//    poll,      
+	std::uint64_t lag() const noexcept
+	{
+		const auto now = elapsed();
+		return now - std::min(now, timers.now());
+	}
+
+	template<typename Duration>
+	static std::uint64_t ticks(Duration delay) noexcept
+	{
+		return (std::uint64_t)std::max<std::int64_t>(std::chrono::ceil<std::chrono::milliseconds>(delay).count(), 0);
+	}
+
+	//   :     ,    
+	void watchIdle(Connection& connection)
+	{
+		const auto now = elapsed();
+		const auto quiet = std::chrono::milliseconds(now - std::min(now, connection.activity));
+		if (quiet >= idle)
+		{
+			connection.idleTimer = 0;
+			close(connection);
+			return;
+		}
+		connection.idleTimer = schedule(idle - quiet, [this, &connection]() { watchIdle(connection); });
+	}
+
+	void closeAll()
+	{
+		while (!connections.empty())
+		{
+			close(*connections.begin()->second);
+		}
+		closed.clear();
+	}
+
+	void onAccepted(int fd) override
+	{
+		auto connection = std::make_unique<Connection>();
+		connection->fd = fd;
+		connection->id = nextId++;
+		connection->decoder = FrameDecoder(frameOptions);
+		connection->activity = elapsed();
+		auto& reference = *connection;
+		connections[fd] = std::move(connection);
+		metrics.accepted.add();
+		metrics.connections.add();
+		engine->attach(reference);
+		if (idle.count() > 0)
+		{
+			reference.idleTimer = schedule(idle, [this, &reference]() { watchIdle(reference); });
+		}
+		handler.onAccept(reference);
+	}
+
+	void onReceived(Connection& connection, const IoBuffer& data) override
+	{
+		if (connection.closing)
+		{
+			return;
+		}
+		connection.activity = elapsed();
+		metrics.bytesIn.add(data.size());
+		if (!connection.decoder.enabled())
+		{
+			dispatch(connection, data);
+			settle(connection);
+			return;
+		}
+		auto& pipeline = connection.pipeline;
+		const auto valid = connection.decoder.feed(data, [&](const IoBuffer& frame) {
+			if (connection.closing)
+			{
+				return false;
+			}
+			pipeline.begin();
+			dispatch(connection, frame);
+			pipeline.end(connection.replies);
+			return !connection.closing;
+		});
+		flushReplies(connection);
+		if (!valid)
+		{
+			report("  maxFrame");
+			close(connection);
+		}
+		settle(connection);
+	}
+
+	void dispatch(Connection& connection, const IoBuffer& data)
+	{
+		const auto begin = Clock::now();
+		handler.onData(connection, data);
+		metrics.messages.add();
+		metrics.handlerTime.record((std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - begin).count());
+	}
+
+	void onWritten(Connection& connection, size_t bytes) override
+	{
+		consume(connection.output, bytes);
+		metrics.bytesOut.add(bytes);
+		metrics.queuedBytes.subtract(std::min(bytes, connection.queued));
+		connection.queued -= std::min(bytes, connection.queued);
+		if (connection.closing)
+		{
+			return;
+		}
+		if (connection.paused && connection.queued <= lowWatermark && !connection.held)
+		{
+			connection.paused = false;
+			metrics.paused.subtract(1);
+			engine->resume(connection);
+		}
+		if (connection.queued == 0 && connection.congested)
+		{
+			connection.congested = false;
+			handler.onDrain(connection);
+		}
+		settle(connection);
+	}
+
+	void onWake() override
+	{
+		notified = false;
+		if (drainRequested.exchange(false))
+		{
+			beginDrain();
+		}
+		runTasks();
+	}
+
+	//   ;    ,      -
+	void runTasks()
+	{
+		static constexpr size_t batch = 256;
+		std::function<void()> task;
+		size_t count = 0;
+		while (count != batch && tasks.pop(task))
+		{
+			count++;
+			task();
+		}
+		metrics.tasks.add(count);
+		if (count == batch)
+		{
+			wake();
+		}
+	}
+
+	void beginDrain()
+	{
+		if (draining)
+		{
+			return;
+		}
+		draining = true;
+		engine->unlisten();
+		schedule(std::chrono::milliseconds(drainTimeout.load()), [this]() { running = false; });
+		std::vector<Connection*> current;
+		for (const auto& [fd, connection] : connections)
+		{
+			current.push_back(connection.get());
+		}
+		for (const auto connection : current)
+		{
+			settle(*connection);
+		}
+	}
+
+	//    ,        
+	void settle(Connection& connection)
+	{
+		if (draining && !connection.closing && connection.output.empty() && connection.pipeline.pending() == 0)
+		{
+			close(connection);
+		}
+	}
+
+	void onClosed(Connection& connection) override
+	{
+		close(connection);
+	}
+
+	void onFailure(const std::string& message) override
+	{
+		report(message);
+	}
+
+public:
+	//  :    ,    onData
+	BufferPool& buffers() override
+	{
+		return pool;
+	}
+};
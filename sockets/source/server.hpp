@@ -0,0 +1,364 @@
+#pragma once
+
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include "main.hpp"
+#include "reactor.hpp"
+#include "epoll.hpp"
+#include "coroutine.hpp"
+#ifdef SOCKETS_IO_URING
+#include "uring.hpp"
+#endif
+
+enum class EngineKind
+{
+	Epoll,
+	Uring
+};
+
+struct ServerOptions
+{
+	EngineKind engine = EngineKind::Epoll;
+	size_t loops = 1;
+	bool pinThreads = true;
+	size_t lowWatermark = 64 * 1024;
+	size_t highWatermark = 1024 * 1024;
+	FrameOptions framing;
+	std::chrono::milliseconds idleTimeout{ 0 };
+	//        Prometheus, 0 
+	int statsPort = 0;
+};
+
+class AsyncTcpServer : public AsyncSocketAPI, private IEventHandler
+{
+private:
+	//     ,    
+	struct Reactor
+	{
+		SOCKET listenSocket = INVALID_SOCKET;
+		std::unique_ptr<CoroutineHandler> sessions;
+		std::unique_ptr<EventLoop> loop;
+		std::thread worker;
+	};
+
+	ServerOptions options;
+	std::vector<Reactor> reactors;
+	SOCKET statsSocket = INVALID_SOCKET;
+	std::thread statsWorker;
+public:
+	explicit AsyncTcpServer(const ServerOptions& options = {}) : options(options)
+	{
+	}
+
+	~AsyncTcpServer()
+	{
+		stop();
+	}
+
+	void start(int port) override
+	{
+		open(port, nullptr);
+	}
+
+	//  : listener        
+	void serve(int port, CoroutineHandler::Listener listener)
+	{
+		open(port, listener);
+	}
+
+	void stop() override
+	{
+		if (statsSocket != INVALID_SOCKET)
+		{
+			// shutdown  ,   accept
+			shutdown(statsSocket, SHUT_RDWR);
+			if (statsWorker.joinable()) statsWorker.join();
+			closesocket(statsSocket);
+			statsSocket = INVALID_SOCKET;
+		}
+		for (auto& reactor : reactors)
+		{
+			if (reactor.loop) reactor.loop->stop();
+		}
+		for (auto& reactor : reactors)
+		{
+			if (reactor.worker.joinable()) reactor.worker.join();
+			reactor.loop.reset();
+			if (reactor.listenSocket != INVALID_SOCKET) closesocket(reactor.listenSocket);
+		}
+		reactors.clear();
+	}
+
+	//  :  ,  ,  timeout  
+	void drain(std::chrono::milliseconds timeout)
+	{
+		for (auto& reactor : reactors)
+		{
+			if (reactor.loop) reactor.loop->drain(timeout);
+		}
+		for (auto& reactor : reactors)
+		{
+			if (reactor.worker.joinable()) reactor.worker.join();
+		}
+		stop();
+	}
+
+	//    ,  
+	size_t send(SOCKET client, std::span<const IoBuffer> parts)
+	{
+		const auto loop = EventLoop::current();
+		const auto connection = loop ? loop->find(client) : nullptr;
+		return connection ? loop->send(*connection, parts) : 0;
+	}
+
+	size_t send(SOCKET client, std::string_view data)
+	{
+		const IoBuffer part(data);
+		return send(client, std::span(&part, 1));
+	}
+
+	//       ,   onReceive
+	ConnectionRef reference(SOCKET client)
+	{
+		const auto loop = EventLoop::current();
+		const auto connection = loop ? loop->find(client) : nullptr;
+		return connection ? loop->reference(*connection) : ConnectionRef{};
+	}
+
+	//     stop():   ,  
+	void send(const ConnectionRef& target, std::string data)
+	{
+		if (target) target.loop->post(target, std::move(data));
+	}
+
+	void reply(const ConnectionRef& target, std::uint64_t ticket, std::string data)
+	{
+		if (target) target.loop->post(target, ticket, std::move(data));
+	}
+
+	//    ,   onReceive;     
+	std::uint64_t defer(SOCKET client)
+	{
+		const auto loop = EventLoop::current();
+		const auto connection = loop ? loop->find(client) : nullptr;
+		return connection ? loop->defer(*connection) : Pipeline::none;
+	}
+
+	size_t reply(SOCKET client, std::uint64_t ticket, std::span<const IoBuffer> parts)
+	{
+		const auto loop = EventLoop::current();
+		const auto connection = loop ? loop->find(client) : nullptr;
+		return connection ? loop->reply(*connection, ticket, parts) : 0;
+	}
+
+	size_t size() const noexcept
+	{
+		return reactors.size();
+	}
+
+	//     
+	MetricsSnapshot stats() const
+	{
+		MetricsSnapshot snapshot;
+		for (const auto& reactor : reactors)
+		{
+			if (reactor.loop) snapshot.add(reactor.loop->stats());
+		}
+		return snapshot;
+	}
+
+protected:
+	//  
+	void onReceive(std::string_view data, SOCKET client) override
+	{
+		static constexpr std::string_view prefix = "Echo: ";
+		char header[4];
+		FrameDecoder::encode((std::uint32_t)(prefix.size() + data.size()), header);
+		const auto length = options.framing.mode == FrameMode::Length;
+		const auto delimited = options.framing.mode == FrameMode::Delimiter;
+		const IoBuffer reply[]{
+			IoBuffer(std::string_view(header, length ? sizeof(header) : 0)),
+			IoBuffer(prefix, true),
+			IoBuffer(data),
+			IoBuffer(std::string_view(&options.framing.delimiter, delimited ? 1 : 0))
+		};
+		const auto sent = send(client, reply);
+		if (sent > 0) onSend(sent, client);
+	}
+
+	//     IoBuffer       
+	void onData(Connection& connection, const IoBuffer& data) override
+	{
+		onReceive(data.view(), connection.fd);
+	}
+
+	//  ,   highWatermark,   
+	void onDrain(Connection&) override
+	{
+	}
+
+	//     stats(),        
+	void onSend(size_t, SOCKET) override
+	{
+	}
+
+	void onError(const std::string& msg) override
+	{
+		std::cerr << ": " << msg << std::endl;
+	}
+
+private:
+	void open(int port, const CoroutineHandler::Listener& listener)
+	{
+		const auto count = std::max<size_t>(options.loops, 1);
+		reactors.resize(count);
+		for (size_t i = 0; i != count; i++)
+		{
+			auto& reactor = reactors[i];
+			reactor.listenSocket = openListener(port);
+			if (reactor.listenSocket == INVALID_SOCKET)
+			{
+				stop();
+				return;
+			}
+			if (listener)
+			{
+				reactor.sessions = std::make_unique<CoroutineHandler>(listener, [this](const std::string& message) { onError(message); }, options.highWatermark);
+			}
+			reactor.loop = createLoop(reactor.sessions ? *reactor.sessions : static_cast<IEventHandler&>(*this));
+			if (reactor.sessions) reactor.sessions->bind(*reactor.loop);
+			reactor.loop->watermarks(options.lowWatermark, options.highWatermark);
+			reactor.loop->framing(options.framing);
+			reactor.loop->idleTimeout(options.idleTimeout);
+			reactor.loop->listen(reactor.listenSocket);
+		}
+		if (options.statsPort)
+		{
+			statsSocket = openListener(options.statsPort);
+			if (statsSocket != INVALID_SOCKET)
+			{
+				fcntl(statsSocket, F_SETFL, fcntl(statsSocket, F_GETFL) & ~O_NONBLOCK);
+				statsWorker = std::thread([this]() { serveStats(); });
+			}
+		}
+		for (size_t i = 0; i != count; i++)
+		{
+			reactors[i].worker = std::thread([this, i, loop = reactors[i].loop.get()]() {
+				if (options.pinThreads) pin(i);
+				loop->run();
+			});
+		}
+	}
+
+	SOCKET openListener(int port)
+	{
+		const auto listenSocket = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_TCP);
+		if (listenSocket == INVALID_SOCKET)
+		{
+			onError(" socket()");
+			return INVALID_SOCKET;
+		}
+
+		//        
+		const int enable = 1;
+		setsockopt(listenSocket, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+		setsockopt(listenSocket, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+
+		sockaddr_in service{};
+		service.sin_family = AF_INET;
+		service.sin_addr.s_addr = INADDR_ANY;
+		service.sin_port = htons(port);
+
+		if (bind(listenSocket, (SOCKADDR*)&service, sizeof(service)) == SOCKET_ERROR)
+		{
+			onError(" bind()");
+			closesocket(listenSocket);
+			return INVALID_SOCKET;
+		}
+
+		if (::listen(listenSocket, SOMAXCONN) == SOCKET_ERROR)
+		{
+			onError(" listen()");
+			closesocket(listenSocket);
+			return INVALID_SOCKET;
+		}
+		return listenSocket;
+	}
+
+	//     accept:       
+	void serveStats()
+	{
+		while (true)
+		{
+			const auto client = accept4(statsSocket, nullptr, nullptr, SOCK_CLOEXEC);
+			if (client == INVALID_SOCKET)
+			{
+				if (errno == EINTR || errno == ECONNABORTED) continue;
+				break;
+			}
+			timeval timeout{ 0, 100000 };
+			setsockopt(client, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+			char request[1024];
+			recv(client, request, sizeof(request), 0);
+
+			const auto body = stats().text();
+			const auto response = "HTTP/1.0 200 OK\r\nContent-Type: text/plain; version=0.0.4\r\nContent-Length: " + std::to_string(body.size()) + "\r\n\r\n" + body;
+			for (size_t sent = 0; sent < response.size();)
+			{
+				const auto count = ::send(client, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+				if (count <= 0) break;
+				sent += (size_t)count;
+			}
+			closesocket(client);
+		}
+	}
+
+	static void pin(size_t index) noexcept
+	{
+		const auto cores = std::max(std::thread::hardware_concurrency(), 1u);
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(index % cores, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	}
+
+	std::unique_ptr<EventLoop> createLoop(IEventHandler& handler)
+	{
+#ifdef SOCKETS_IO_URING
+		if (options.engine == EngineKind::Uring)
+		{
+			try
+			{
+				return EventLoop::create<UringEngine>(handler);
+			}
+			catch (const std::system_error& error)
+			{
+				onError(std::string("io_uring ,  epoll: ") + error.what());
+			}
+		}
+#endif
+		return EventLoop::create<EpollEngine>(handler);
+	}
+
+	void onStart() override
+	{
+	}
+
+	void onStop() override
+	{
+	}
+
+	void onAccept(Connection&) override
+	{
+	}
+
+	void onClose(Connection&) override
+	{
+	}
+
+	void onFailure(const std::string& message) override
+	{
+		onError(message);
+	}
+};
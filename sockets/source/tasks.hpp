@@ -0,0 +1,82 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+
+//       (): push -  exchange  , pop    
+class TaskQueue
+{
+private:
+	struct Node
+	{
+		std::atomic<Node*> next{ nullptr };
+		std::function<void()> task;
+	};
+
+	alignas(64) std::atomic<Node*> head;
+	alignas(64) Node* tail;
+	Node stub;
+public:
+	TaskQueue() noexcept : head(&stub), tail(&stub)
+	{
+	}
+
+	TaskQueue(const TaskQueue&) = delete;
+	TaskQueue& operator=(const TaskQueue&) = delete;
+
+	~TaskQueue()
+	{
+		std::function<void()> task;
+		while (pop(task))
+		{
+		}
+	}
+
+	void push(std::function<void()> task)
+	{
+		const auto node = new Node;
+		node->task = std::move(task);
+		append(node);
+	}
+
+	// false,         ;     
+	bool pop(std::function<void()>& task)
+	{
+		auto first = tail;
+		auto next = first->next.load(std::memory_order_acquire);
+		if (first == &stub)
+		{
+			if (!next)
+			{
+				return false;
+			}
+			tail = next;
+			first = next;
+			next = next->next.load(std::memory_order_acquire);
+		}
+		if (!next)
+		{
+			if (first != head.load(std::memory_order_acquire))
+			{
+				return false;
+			}
+			append(&stub);
+			next = first->next.load(std::memory_order_acquire);
+			if (!next)
+			{
+				return false;
+			}
+		}
+		tail = next;
+		task = std::move(first->task);
+		delete first;
+		return true;
+	}
+private:
+	void append(Node* node) noexcept
+	{
+		node->next.store(nullptr, std::memory_order_relaxed);
+		const auto previous = head.exchange(node, std::memory_order_acq_rel);
+		previous->next.store(node, std::memory_order_release);
+	}
+};
@@ -0,0 +1,254 @@
+#pragma once
+
+#include <cstdint>
+#include <array>
+#include <deque>
+#include <vector>
+#include <bit>
+#include <functional>
+#include <algorithm>
+
+//      1 : ,     O(1)
+class TimerWheel
+{
+private:
+	static constexpr unsigned bits = 8;
+	static constexpr size_t slots = size_t(1) << bits;
+	static constexpr size_t levels = 4;
+	static constexpr std::uint64_t mask = slots - 1;
+	static constexpr std::uint64_t horizon = (std::uint64_t(1) << (bits * levels)) - 1;
+
+	struct Node
+	{
+		Node* prev = nullptr;
+		Node* next = nullptr;
+		std::uint64_t deadline = 0;
+		std::uint32_t index = 0;
+		std::uint32_t generation = 1;
+		std::function<void()> callback;
+
+		void unlink() noexcept
+		{
+			prev->next = next;
+			next->prev = prev;
+			prev = next = nullptr;
+		}
+
+		void append(Node& head) noexcept
+		{
+			prev = head.prev;
+			next = &head;
+			head.prev->next = this;
+			head.prev = this;
+		}
+
+		void reset() noexcept
+		{
+			prev = next = this;
+		}
+	};
+
+	std::deque<Node> nodes;
+	std::vector<std::uint32_t> freeNodes;
+	std::array<std::array<Node, slots>, levels> wheel;
+	//    ,       
+	std::array<std::uint64_t, slots / 64> occupied{};
+	std::uint64_t current;
+	size_t count;
+public:
+	TimerWheel() : current(0), count(0)
+	{
+		for (auto& level : wheel)
+		{
+			for (auto& head : level)
+			{
+				head.reset();
+			}
+		}
+	}
+
+	TimerWheel(const TimerWheel&) = delete;
+	TimerWheel& operator=(const TimerWheel&) = delete;
+
+	std::uint64_t now() const noexcept
+	{
+		return current;
+	}
+
+	size_t size() const noexcept
+	{
+		return count;
+	}
+
+	std::uint64_t schedule(std::uint64_t delay, std::function<void()> callback)
+	{
+		std::uint32_t index;
+		if (freeNodes.empty())
+		{
+			index = (std::uint32_t)nodes.size();
+			nodes.emplace_back().index = index;
+		}
+		else
+		{
+			index = freeNodes.back();
+			freeNodes.pop_back();
+		}
+		auto& node = nodes[index];
+		node.callback = std::move(callback);
+		insert(node, current + std::max<std::uint64_t>(delay, 1));
+		count++;
+		return identify(node);
+	}
+
+	//     
+	bool rearm(std::uint64_t id, std::uint64_t delay) noexcept
+	{
+		const auto node = find(id);
+		if (!node)
+		{
+			return false;
+		}
+		node->unlink();
+		insert(*node, current + std::max<std::uint64_t>(delay, 1));
+		return true;
+	}
+
+	bool cancel(std::uint64_t id) noexcept
+	{
+		const auto node = find(id);
+		if (!node)
+		{
+			return false;
+		}
+		node->unlink();
+		free(*node);
+		return true;
+	}
+
+	//     now    
+	void advance(std::uint64_t now)
+	{
+		if (count == 0)
+		{
+			current = std::max(current, now);
+			return;
+		}
+		while (current < now)
+		{
+			current++;
+			const auto slot = current & mask;
+			if (slot == 0)
+			{
+				cascade(1);
+			}
+			auto& head = wheel[0][slot];
+			if (head.next == &head)
+			{
+				continue;
+			}
+			occupied[slot / 64] &= ~(std::uint64_t(1) << (slot % 64));
+
+			//       :    
+			Node expired;
+			expired.reset();
+			expired.next = head.next;
+			expired.prev = head.prev;
+			expired.next->prev = &expired;
+			expired.prev->next = &expired;
+			head.reset();
+			while (expired.next != &expired)
+			{
+				const auto node = expired.next;
+				node->unlink();
+				auto callback = std::move(node->callback);
+				free(*node);
+				callback();
+			}
+		}
+	}
+
+	//      ,   limit
+	std::uint64_t timeout(std::uint64_t limit) const noexcept
+	{
+		if (count == 0)
+		{
+			return limit;
+		}
+		//       
+		const auto cascadeDelay = slots - (current & mask);
+		const auto start = (current + 1) & mask;
+		for (size_t distance = 0; distance < slots;)
+		{
+			const auto slot = (start + distance) & mask;
+			const auto word = occupied[slot / 64] >> (slot % 64);
+			if (word)
+			{
+				return std::min<std::uint64_t>({ distance + 1 + std::countr_zero(word), cascadeDelay, limit });
+			}
+			distance += 64 - slot % 64;
+		}
+		return std::min<std::uint64_t>(cascadeDelay, limit);
+	}
+private:
+	std::uint64_t identify(const Node& node) const noexcept
+	{
+		return (std::uint64_t(node.generation) << 32) | node.index;
+	}
+
+	Node* find(std::uint64_t id) noexcept
+	{
+		const auto index = (std::uint32_t)id;
+		if (index >= nodes.size())
+		{
+			return nullptr;
+		}
+		auto& node = nodes[index];
+		return (node.generation == (std::uint32_t)(id >> 32) && node.prev) ? &node : nullptr;
+	}
+
+	void free(Node& node) noexcept
+	{
+		node.callback = nullptr;
+		node.generation++;
+		freeNodes.push_back(node.index);
+		count--;
+	}
+
+	void insert(Node& node, std::uint64_t deadline) noexcept
+	{
+		node.deadline = std::min(deadline, current + horizon);
+		const auto delta = node.deadline - current;
+		size_t level = 0;
+		while (level + 1 != levels && delta >= (std::uint64_t(1) << (bits * (level + 1))))
+		{
+			level++;
+		}
+		const auto slot = (node.deadline >> (bits * level)) & mask;
+		node.append(wheel[level][slot]);
+		if (level == 0)
+		{
+			occupied[slot / 64] |= std::uint64_t(1) << (slot % 64);
+		}
+	}
+
+	//      ,     
+	void cascade(size_t level) noexcept
+	{
+		if (level == levels)
+		{
+			return;
+		}
+		const auto slot = (current >> (bits * level)) & mask;
+		if (slot == 0)
+		{
+			cascade(level + 1);
+		}
+		auto& head = wheel[level][slot];
+		while (head.next != &head)
+		{
+			const auto node = head.next;
+			node->unlink();
+			insert(*node, node->deadline);
+		}
+	}
+};
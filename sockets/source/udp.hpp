@@ -0,0 +1,418 @@
+#pragma once
+
+#include <netinet/udp.h>
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <cerrno>
+#include <cstring>
+#include <climits>
+#include "metrics.hpp"
+
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+struct Datagram
+{
+	//        onDatagrams
+	std::string_view data;
+	const sockaddr* peer = nullptr;
+	socklen_t peerLength = 0;
+};
+
+struct UdpOptions
+{
+	size_t loops = 1;
+	bool pinThreads = true;
+	size_t batch = 64;
+	size_t maxDatagram = 2048;
+	// GRO      , GSO        
+	bool gro = false;
+	bool gso = false;
+};
+
+//     sendmmsg    
+class DatagramWriter
+{
+private:
+	static constexpr size_t maxSegments = 64;
+	static constexpr size_t maxPayload = 65507;
+
+	struct Entry
+	{
+		const sockaddr* peer;
+		socklen_t peerLength;
+		size_t firstPart;
+		size_t parts;
+		size_t size;
+	};
+
+	std::vector<Entry> entries;
+	std::vector<iovec> vectors;
+	std::vector<mmsghdr> messages;
+	//     
+	std::vector<size_t> counts;
+	std::vector<std::array<char, CMSG_SPACE(sizeof(std::uint16_t))>> controls;
+public:
+	bool gso = false;
+
+	//       onDatagrams
+	void send(const sockaddr* peer, socklen_t peerLength, std::span<const std::string_view> parts)
+	{
+		Entry entry{ peer, peerLength, vectors.size(), 0, 0 };
+		for (const auto part : parts)
+		{
+			if (part.empty())
+			{
+				continue;
+			}
+			vectors.push_back({ const_cast<char*>(part.data()), part.size() });
+			entry.parts++;
+			entry.size += part.size();
+		}
+		entries.push_back(entry);
+	}
+
+	void send(const Datagram& to, std::string_view data)
+	{
+		send(to.peer, to.peerLength, std::span(&data, 1));
+	}
+
+	bool empty() const noexcept
+	{
+		return entries.empty();
+	}
+
+	//    ; ,      ,     UDP
+	size_t flush(int fd, size_t& dropped)
+	{
+		size_t sent = 0;
+		while (!entries.empty())
+		{
+			build();
+			size_t offset = 0;
+			auto retry = false;
+			while (offset != messages.size())
+			{
+				const auto count = sendmmsg(fd, messages.data() + offset, (unsigned)(messages.size() - offset), MSG_NOSIGNAL);
+				if (count < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					//   UDP_SEGMENT     
+					if (gso && (errno == EIO || errno == EINVAL || errno == EOPNOTSUPP) && offset == 0)
+					{
+						gso = false;
+						retry = true;
+						break;
+					}
+					for (size_t i = offset; i != messages.size(); i++)
+					{
+						dropped += counts[i];
+					}
+					break;
+				}
+				for (int i = 0; i < count; i++)
+				{
+					sent += messages[offset + i].msg_len;
+				}
+				offset += (size_t)count;
+			}
+			if (!retry)
+			{
+				entries.clear();
+				vectors.clear();
+			}
+		}
+		return sent;
+	}
+private:
+	//             UDP_SEGMENT
+	void build()
+	{
+		messages.clear();
+		counts.clear();
+		controls.resize(entries.size());
+		for (size_t i = 0; i != entries.size();)
+		{
+			const auto& first = entries[i];
+			size_t last = i + 1;
+			size_t total = first.size;
+			if (gso)
+			{
+				while (last != entries.size() && last - i < maxSegments)
+				{
+					const auto& next = entries[last];
+					if (next.peerLength != first.peerLength || std::memcmp(next.peer, first.peer, first.peerLength) != 0
+						|| next.size > first.size || total + next.size > maxPayload || entries[last - 1].size != first.size)
+					{
+						break;
+					}
+					total += next.size;
+					last++;
+				}
+			}
+			mmsghdr message{};
+			auto& header = message.msg_hdr;
+			header.msg_name = const_cast<sockaddr*>(first.peer);
+			header.msg_namelen = first.peerLength;
+			header.msg_iov = vectors.data() + first.firstPart;
+			header.msg_iovlen = entries[last - 1].firstPart + entries[last - 1].parts - first.firstPart;
+			if (last - i > 1)
+			{
+				auto& control = controls[messages.size()];
+				header.msg_control = control.data();
+				header.msg_controllen = control.size();
+				const auto cmsg = CMSG_FIRSTHDR(&header);
+				cmsg->cmsg_level = SOL_UDP;
+				cmsg->cmsg_type = UDP_SEGMENT;
+				cmsg->cmsg_len = CMSG_LEN(sizeof(std::uint16_t));
+				const auto segment = (std::uint16_t)first.size;
+				std::memcpy(CMSG_DATA(cmsg), &segment, sizeof(segment));
+			}
+			messages.push_back(message);
+			counts.push_back(last - i);
+			i = last;
+		}
+	}
+};
+
+class UdpServer
+{
+private:
+	struct Worker
+	{
+		int fd = -1;
+		int wakeFd = -1;
+		LoopMetrics metrics;
+		std::thread thread;
+	};
+
+	UdpOptions options;
+	std::vector<std::unique_ptr<Worker>> workers;
+	std::atomic<bool> running;
+public:
+	explicit UdpServer(const UdpOptions& options = {}) : options(options), running(false)
+	{
+	}
+
+	virtual ~UdpServer()
+	{
+		stop();
+	}
+
+	void start(int port)
+	{
+		const auto count = std::max<size_t>(options.loops, 1);
+		running = true;
+		for (size_t i = 0; i != count; i++)
+		{
+			auto worker = std::make_unique<Worker>();
+			worker->fd = openSocket(port);
+			worker->wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+			if (worker->fd < 0 || worker->wakeFd < 0)
+			{
+				if (worker->fd >= 0) ::close(worker->fd);
+				if (worker->wakeFd >= 0) ::close(worker->wakeFd);
+				stop();
+				return;
+			}
+			workers.push_back(std::move(worker));
+		}
+		for (size_t i = 0; i != workers.size(); i++)
+		{
+			workers[i]->thread = std::thread([this, i, worker = workers[i].get()]() {
+				if (options.pinThreads) pin(i);
+				run(*worker);
+			});
+		}
+	}
+
+	void stop()
+	{
+		running = false;
+		for (auto& worker : workers)
+		{
+			const std::uint64_t one = 1;
+			[[maybe_unused]] const auto written = ::write(worker->wakeFd, &one, sizeof(one));
+		}
+		for (auto& worker : workers)
+		{
+			if (worker->thread.joinable()) worker->thread.join();
+			::close(worker->fd);
+			::close(worker->wakeFd);
+		}
+		workers.clear();
+	}
+
+	MetricsSnapshot stats() const
+	{
+		MetricsSnapshot snapshot;
+		for (const auto& worker : workers)
+		{
+			snapshot.add(worker->metrics);
+		}
+		return snapshot;
+	}
+
+protected:
+	//     ;    writer    sendmmsg
+	virtual void onDatagrams(std::span<const Datagram> batch, DatagramWriter& writer)
+	{
+		static constexpr std::string_view prefix = "Echo: ";
+		for (const auto& datagram : batch)
+		{
+			const std::string_view parts[]{ prefix, datagram.data };
+			writer.send(datagram.peer, datagram.peerLength, parts);
+		}
+	}
+
+	virtual void onError(const std::string& msg)
+	{
+		std::cerr << ": " << msg << std::endl;
+	}
+
+private:
+	int openSocket(int port)
+	{
+		const auto fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, IPPROTO_UDP);
+		if (fd < 0)
+		{
+			onError(" socket()");
+			return -1;
+		}
+		const int enable = 1;
+		setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+		setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &enable, sizeof(enable));
+		if (options.gro && setsockopt(fd, SOL_UDP, UDP_GRO, &enable, sizeof(enable)) != 0)
+		{
+			onError("UDP_GRO ");
+		}
+
+		sockaddr_in service{};
+		service.sin_family = AF_INET;
+		service.sin_addr.s_addr = INADDR_ANY;
+		service.sin_port = htons(port);
+		if (bind(fd, (SOCKADDR*)&service, sizeof(service)) != 0)
+		{
+			onError(" bind()");
+			::close(fd);
+			return -1;
+		}
+		return fd;
+	}
+
+	void run(Worker& worker)
+	{
+		const auto batch = std::max<size_t>(options.batch, 1);
+		//  GRO        
+		const auto capacity = options.gro ? size_t(65535) : std::max<size_t>(options.maxDatagram, 1);
+		std::vector<char> arena(batch * capacity);
+		std::vector<iovec> vectors(batch);
+		std::vector<mmsghdr> messages(batch);
+		std::vector<sockaddr_storage> peers(batch);
+		std::vector<std::array<char, CMSG_SPACE(sizeof(int))>> controls(batch);
+		std::vector<Datagram> datagrams;
+		DatagramWriter writer;
+		writer.gso = options.gso;
+		for (size_t i = 0; i != batch; i++)
+		{
+			vectors[i] = { arena.data() + i * capacity, capacity };
+		}
+
+		while (running)
+		{
+			for (size_t i = 0; i != batch; i++)
+			{
+				auto& header = messages[i].msg_hdr;
+				header.msg_name = &peers[i];
+				header.msg_namelen = sizeof(sockaddr_storage);
+				header.msg_iov = &vectors[i];
+				header.msg_iovlen = 1;
+				header.msg_control = options.gro ? controls[i].data() : nullptr;
+				header.msg_controllen = options.gro ? controls[i].size() : 0;
+				header.msg_flags = 0;
+			}
+			const auto count = recvmmsg(worker.fd, messages.data(), (unsigned)batch, MSG_DONTWAIT, nullptr);
+			if (count <= 0)
+			{
+				if (count < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+				{
+					worker.metrics.errors.add();
+					onError(" recvmmsg()");
+				}
+				// stop   eventfd
+				pollfd descriptors[]{ { worker.fd, POLLIN, 0 }, { worker.wakeFd, POLLIN, 0 } };
+				poll(descriptors, 2, -1);
+				continue;
+			}
+
+			datagrams.clear();
+			for (int i = 0; i < count; i++)
+			{
+				const auto& header = messages[i].msg_hdr;
+				const std::string_view data((const char*)vectors[i].iov_base, messages[i].msg_len);
+				worker.metrics.bytesIn.add(data.size());
+				//   maxDatagram   -     
+				if (header.msg_flags & MSG_TRUNC)
+				{
+					worker.metrics.errors.add();
+					continue;
+				}
+				const auto segment = options.gro ? segmentSize(header) : 0;
+				if (!segment)
+				{
+					datagrams.push_back({ data, (const sockaddr*)header.msg_name, header.msg_namelen });
+					continue;
+				}
+				for (size_t offset = 0; offset < data.size(); offset += segment)
+				{
+					datagrams.push_back({ data.substr(offset, segment), (const sockaddr*)header.msg_name, header.msg_namelen });
+				}
+			}
+
+			if (datagrams.empty())
+			{
+				continue;
+			}
+			const auto begin = std::chrono::steady_clock::now();
+			onDatagrams(datagrams, writer);
+			worker.metrics.messages.add(datagrams.size());
+			worker.metrics.handlerTime.record((std::uint64_t)std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - begin).count());
+			if (!writer.empty())
+			{
+				size_t dropped = 0;
+				worker.metrics.bytesOut.add(writer.flush(worker.fd, dropped));
+				worker.metrics.errors.add(dropped);
+			}
+		}
+	}
+
+	static size_t segmentSize(const msghdr& header) noexcept
+	{
+		for (auto cmsg = CMSG_FIRSTHDR(const_cast<msghdr*>(&header)); cmsg; cmsg = CMSG_NXTHDR(const_cast<msghdr*>(&header), cmsg))
+		{
+			if (cmsg->cmsg_level == SOL_UDP && cmsg->cmsg_type == UDP_GRO)
+			{
+				int size = 0;
+				std::memcpy(&size, CMSG_DATA(cmsg), sizeof(size));
+				return (size_t)std::max(size, 0);
+			}
+		}
+		return 0;
+	}
+
+	static void pin(size_t index) noexcept
+	{
+		const auto cores = std::max(std::thread::hardware_concurrency(), 1u);
+		cpu_set_t set;
+		CPU_ZERO(&set);
+		CPU_SET(index % cores, &set);
+		pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+	}
+};
@@ -0,0 +1,596 @@
+#pragma once
+
+#include <vector>
+#include <string>
+#include <unordered_map>
+#include <atomic>
+#include <linux/io_uring.h>
+#include <linux/time_types.h>
+#include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/resource.h>
+#include <climits>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <system_error>
+#include "reactor.hpp"
+
+//  io_uring  liburing
+class UringQueue
+{
+private:
+	int ringFd;
+	io_uring_params params;
+	void* rings;
+	size_t ringsSize;
+	io_uring_sqe* sqes;
+	unsigned* sqHead;
+	unsigned* sqTail;
+	unsigned* cqHead;
+	unsigned* cqTail;
+	io_uring_cqe* cqes;
+	unsigned tail;
+public:
+	explicit UringQueue(unsigned entries) : params{}, rings(MAP_FAILED), sqes((io_uring_sqe*)MAP_FAILED), tail(0)
+	{
+		params.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN;
+		params.cq_entries = entries * 4;
+		ringFd = (int)syscall(__NR_io_uring_setup, entries, &params);
+		if (ringFd == -1)
+		{
+			throw std::system_error(errno, std::generic_category(), "io_uring_setup");
+		}
+		if (!(params.features & IORING_FEAT_SINGLE_MMAP) || !(params.features & IORING_FEAT_EXT_ARG))
+		{
+			::close(ringFd);
+			throw std::system_error(ENOSYS, std::generic_category(), "io_uring_setup");
+		}
+
+		ringsSize = std::max(params.sq_off.array + params.sq_entries * sizeof(unsigned), params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe));
+		rings = mmap(nullptr, ringsSize, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQ_RING);
+		sqes = (io_uring_sqe*)mmap(nullptr, params.sq_entries * sizeof(io_uring_sqe), PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd, IORING_OFF_SQES);
+		if (rings == MAP_FAILED || sqes == MAP_FAILED)
+		{
+			const auto error = errno;
+			release();
+			throw std::system_error(error, std::generic_category(), "mmap");
+		}
+
+		const auto base = (char*)rings;
+		sqHead = (unsigned*)(base + params.sq_off.head);
+		sqTail = (unsigned*)(base + params.sq_off.tail);
+		cqHead = (unsigned*)(base + params.cq_off.head);
+		cqTail = (unsigned*)(base + params.cq_off.tail);
+		cqes = (io_uring_cqe*)(base + params.cq_off.cqes);
+		const auto array = (unsigned*)(base + params.sq_off.array);
+		for (unsigned i = 0; i != params.sq_entries; i++)
+		{
+			array[i] = i;
+		}
+		tail = *sqTail;
+	}
+
+	UringQueue(const UringQueue&) = delete;
+	UringQueue& operator=(const UringQueue&) = delete;
+
+	~UringQueue()
+	{
+		release();
+	}
+
+	//     ,      
+	io_uring_sqe* get()
+	{
+		if (tail - std::atomic_ref(*sqHead).load(std::memory_order_acquire) == params.sq_entries)
+		{
+			submit(0, 0);
+		}
+		if (tail - std::atomic_ref(*sqHead).load(std::memory_order_acquire) == params.sq_entries)
+		{
+			return nullptr;
+		}
+		const auto sqe = &sqes[tail & (params.sq_entries - 1)];
+		std::memset(sqe, 0, sizeof(*sqe));
+		tail++;
+		return sqe;
+	}
+
+	//          
+	int submit(unsigned waitFor, int timeout)
+	{
+		std::atomic_ref(*sqTail).store(tail, std::memory_order_release);
+		const auto pending = tail - std::atomic_ref(*sqHead).load(std::memory_order_acquire);
+		if (pending == 0 && waitFor == 0)
+		{
+			return 0;
+		}
+		__kernel_timespec time{ .tv_sec = timeout / 1000, .tv_nsec = (timeout % 1000) * 1000000ll };
+		io_uring_getevents_arg argument{ .sigmask = 0, .sigmask_sz = 0, .pad = 0, .ts = (timeout >= 0) ? (std::uint64_t)&time : 0 };
+		const unsigned flags = (waitFor ? IORING_ENTER_GETEVENTS : 0) | IORING_ENTER_EXT_ARG;
+		return (int)syscall(__NR_io_uring_enter, ringFd, pending, waitFor, flags, &argument, sizeof(argument));
+	}
+
+	template<typename Function>
+	unsigned drain(Function&& function)
+	{
+		auto head = *cqHead;
+		const auto last = std::atomic_ref(*cqTail).load(std::memory_order_acquire);
+		const auto count = last - head;
+		for (; head != last; head++)
+		{
+			const auto cqe = cqes[head & (params.cq_entries - 1)];
+			std::atomic_ref(*cqHead).store(head + 1, std::memory_order_release);
+			function(cqe);
+		}
+		return count;
+	}
+
+	int enroll(unsigned opcode, const void* argument, unsigned count) noexcept
+	{
+		return (int)syscall(__NR_io_uring_register, ringFd, opcode, argument, count);
+	}
+private:
+	void release() noexcept
+	{
+		if (sqes != MAP_FAILED) munmap(sqes, params.sq_entries * sizeof(io_uring_sqe));
+		if (rings != MAP_FAILED) munmap(rings, ringsSize);
+		::close(ringFd);
+	}
+};
+
+//  ,          recv
+class UringBufferRing
+{
+private:
+	UringQueue& queue;
+	BufferPool& pool;
+	io_uring_buf* ring;
+	size_t ringSize;
+	std::vector<IoBuffer> slots;
+	unsigned entries;
+	std::uint16_t group;
+public:
+	UringBufferRing(UringQueue& queue, BufferPool& pool, std::uint16_t group, unsigned entries) : queue(queue), pool(pool), ringSize(entries * sizeof(io_uring_buf)), slots(entries), entries(entries), group(group)
+	{
+		ring = (io_uring_buf*)mmap(nullptr, ringSize, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (ring == MAP_FAILED)
+		{
+			throw std::system_error(errno, std::generic_category(), "mmap");
+		}
+		io_uring_buf_reg registration{};
+		registration.ring_addr = (std::uint64_t)ring;
+		registration.ring_entries = entries;
+		registration.bgid = group;
+		if (queue.enroll(IORING_REGISTER_PBUF_RING, &registration, 1) != 0)
+		{
+			const auto error = errno;
+			munmap(ring, ringSize);
+			throw std::system_error(error, std::generic_category(), "IORING_REGISTER_PBUF_RING");
+		}
+		for (unsigned i = 0; i != entries; i++)
+		{
+			recycle((std::uint16_t)i);
+		}
+	}
+
+	UringBufferRing(const UringBufferRing&) = delete;
+	UringBufferRing& operator=(const UringBufferRing&) = delete;
+
+	~UringBufferRing()
+	{
+		io_uring_buf_reg registration{};
+		registration.bgid = group;
+		queue.enroll(IORING_UNREGISTER_PBUF_RING, &registration, 1);
+		munmap(ring, ringSize);
+	}
+
+	IoBuffer take(std::uint16_t id, size_t size) const noexcept
+	{
+		return slots[id].slice(0, size);
+	}
+
+	//      ,      .
+	//      resv   (io_uring_buf_ring).
+	void recycle(std::uint16_t id)
+	{
+		if (!slots[id].unique())
+		{
+			slots[id] = pool.acquire();
+		}
+		const auto tail = ring[0].resv;
+		auto& buffer = ring[tail & (entries - 1)];
+		buffer.addr = (std::uint64_t)slots[id].data();
+		buffer.len = (std::uint32_t)slots[id].size();
+		buffer.bid = id;
+		std::atomic_ref(ring[0].resv).store((std::uint16_t)(tail + 1), std::memory_order_release);
+	}
+
+	std::uint16_t id() const noexcept
+	{
+		return group;
+	}
+};
+
+//   6.0+ (multishot recv   )
+class UringEngine : public IEventEngine
+{
+private:
+	enum Operation : std::uint64_t
+	{
+		Accept = 1,
+		Receive,
+		Send,
+		Update,
+		Cancel,
+		Wake
+	};
+
+	struct Channel
+	{
+		Connection* connection = nullptr;
+		int fd = -1;
+		bool fixed = false;
+		bool sending = false;
+		bool receiving = false;
+		unsigned operations = 0;
+		std::vector<IoBuffer> outgoing;
+		std::vector<iovec> vectors;
+		msghdr message{};
+	};
+
+	static constexpr int unregistered = -1;
+
+	IEventSink& sink;
+	UringQueue queue;
+	UringBufferRing buffers;
+	int listenSocket;
+	int wakeFd;
+	std::uint64_t wakeValue;
+	std::vector<int> files;
+	std::unordered_map<std::uint64_t, Channel> channels;
+public:
+	explicit UringEngine(IEventSink& sink, unsigned entries = 1024, unsigned bufferCount = 256)
+		: sink(sink), queue(entries), buffers(queue, sink.buffers(), 0, bufferCount), listenSocket(-1), wakeFd(-1), wakeValue(0)
+	{
+		rlimit limit{};
+		getrlimit(RLIMIT_NOFILE, &limit);
+		const auto size = (unsigned)std::min<rlim_t>(limit.rlim_cur, 65536);
+		io_uring_rsrc_register registration{};
+		registration.nr = size;
+		registration.flags = IORING_RSRC_REGISTER_SPARSE;
+		if (queue.enroll(IORING_REGISTER_FILES2, &registration, sizeof(registration)) == 0)
+		{
+			files.resize(size, unregistered);
+		}
+	}
+
+	void listen(int socket) override
+	{
+		listenSocket = socket;
+		acceptAll();
+	}
+
+	void unlisten() override
+	{
+		if (listenSocket == -1)
+		{
+			return;
+		}
+		listenSocket = -1;
+		if (const auto sqe = prepare(IORING_OP_ASYNC_CANCEL, -1, 0, Cancel))
+		{
+			sqe->addr = Accept;
+		}
+	}
+
+	void watch(int fd) override
+	{
+		wakeFd = fd;
+		awaitWake();
+	}
+
+	void attach(Connection& connection) override
+	{
+		const int enable = 1;
+		setsockopt(connection.fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+		auto& channel = channels[connection.id];
+		channel.connection = &connection;
+		channel.fd = connection.fd;
+		channel.fixed = (size_t)connection.fd < files.size();
+		if (channel.fixed)
+		{
+			//      recv    
+			files[connection.fd] = connection.fd;
+			if (const auto sqe = prepare(IORING_OP_FILES_UPDATE, -1, connection.id, Update))
+			{
+				sqe->addr = (std::uint64_t)&files[connection.fd];
+				sqe->len = 1;
+				sqe->off = (std::uint64_t)connection.fd;
+				sqe->flags |= IOSQE_IO_LINK;
+			}
+		}
+		receive(connection.id, channel);
+	}
+
+	void detach(Connection& connection) override
+	{
+		const auto iterator = channels.find(connection.id);
+		if (iterator == channels.end())
+		{
+			::close(connection.fd);
+			return;
+		}
+		auto& channel = iterator->second;
+		channel.connection = nullptr;
+		::shutdown(connection.fd, SHUT_RDWR);
+		if (channel.fixed)
+		{
+			files[connection.fd] = unregistered;
+			if (const auto sqe = prepare(IORING_OP_FILES_UPDATE, -1, connection.id, Update))
+			{
+				sqe->addr = (std::uint64_t)&unregistered;
+				sqe->len = 1;
+				sqe->off = (std::uint64_t)connection.fd;
+			}
+		}
+		::close(connection.fd);
+		release(connection.id);
+	}
+
+	//           poll
+	size_t write(Connection&, std::span<const IoBuffer>) override
+	{
+		return 0;
+	}
+
+	void flush(Connection& connection) override
+	{
+		const auto iterator = channels.find(connection.id);
+		if (iterator != channels.end() && !iterator->second.sending)
+		{
+			transmit(connection.id, iterator->second);
+		}
+	}
+
+	void pause(Connection& connection) override
+	{
+		const auto iterator = channels.find(connection.id);
+		if (iterator == channels.end() || !iterator->second.receiving)
+		{
+			return;
+		}
+		if (const auto sqe = prepare(IORING_OP_ASYNC_CANCEL, -1, connection.id, Cancel))
+		{
+			sqe->addr = (connection.id << 8) | Receive;
+		}
+	}
+
+	void resume(Connection& connection) override
+	{
+		const auto iterator = channels.find(connection.id);
+		if (iterator != channels.end() && !iterator->second.receiving)
+		{
+			receive(connection.id, iterator->second);
+		}
+	}
+
+	void poll(int timeout) override
+	{
+		if (queue.submit(1, timeout) == -1 && errno != ETIME && errno != EINTR && errno != EBUSY)
+		{
+			sink.onFailure(" io_uring_enter()");
+		}
+		queue.drain([this](const io_uring_cqe& cqe) { complete(cqe); });
+	}
+private:
+	io_uring_sqe* prepare(std::uint8_t opcode, int fd, std::uint64_t id, Operation operation)
+	{
+		const auto sqe = queue.get();
+		if (!sqe)
+		{
+			sink.onFailure(" io_uring:  ");
+			return nullptr;
+		}
+		sqe->opcode = opcode;
+		sqe->fd = fd;
+		sqe->user_data = (id << 8) | operation;
+		return sqe;
+	}
+
+	void awaitWake()
+	{
+		if (const auto sqe = prepare(IORING_OP_READ, wakeFd, 0, Wake))
+		{
+			sqe->addr = (std::uint64_t)&wakeValue;
+			sqe->len = sizeof(wakeValue);
+		}
+	}
+
+	void acceptAll()
+	{
+		if (const auto sqe = prepare(IORING_OP_ACCEPT, listenSocket, 0, Accept))
+		{
+			sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+			sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+		}
+	}
+
+	void receive(std::uint64_t id, Channel& channel)
+	{
+		if (const auto sqe = prepare(IORING_OP_RECV, channel.fd, id, Receive))
+		{
+			sqe->ioprio = IORING_RECV_MULTISHOT;
+			sqe->flags = IOSQE_BUFFER_SELECT | (channel.fixed ? IOSQE_FIXED_FILE : 0);
+			sqe->buf_group = buffers.id();
+			channel.operations++;
+			channel.receiving = true;
+		}
+	}
+
+	//      :     
+	void transmit(std::uint64_t id, Channel& channel)
+	{
+		const auto& output = channel.connection->output;
+		channel.sending = !output.empty();
+		if (!channel.sending)
+		{
+			return;
+		}
+		channel.outgoing.assign(output.begin(), output.begin() + std::min<size_t>(output.size(), IOV_MAX));
+		channel.vectors.clear();
+		for (const auto& part : channel.outgoing)
+		{
+			channel.vectors.push_back({ (void*)part.data(), part.size() });
+		}
+		channel.message = {};
+		channel.message.msg_iov = channel.vectors.data();
+		channel.message.msg_iovlen = channel.vectors.size();
+		if (const auto sqe = prepare(IORING_OP_SENDMSG, channel.fd, id, Send))
+		{
+			sqe->addr = (std::uint64_t)&channel.message;
+			sqe->len = 1;
+			sqe->msg_flags = MSG_NOSIGNAL;
+			sqe->flags = channel.fixed ? IOSQE_FIXED_FILE : 0;
+			channel.operations++;
+		}
+	}
+
+	//  ,       
+	void release(std::uint64_t id)
+	{
+		const auto iterator = channels.find(id);
+		if (iterator != channels.end() && !iterator->second.connection && iterator->second.operations == 0)
+		{
+			channels.erase(iterator);
+		}
+	}
+
+	void complete(const io_uring_cqe& cqe)
+	{
+		const auto id = cqe.user_data >> 8;
+		const auto operation = (Operation)(cqe.user_data & 0xFF);
+		if (operation == Wake)
+		{
+			if (cqe.res < 0 && cqe.res != -EINTR && cqe.res != -EAGAIN && cqe.res != -ECANCELED)
+			{
+				sink.onFailure("  eventfd");
+			}
+			if (cqe.res != -ECANCELED)
+			{
+				awaitWake(); //  stop()  post()    
+			}
+			sink.onWake();
+			return;
+		}
+		if (operation == Accept)
+		{
+			if (cqe.res >= 0 && listenSocket == -1)
+			{
+				::close(cqe.res); //   unlisten
+			}
+			else if (cqe.res >= 0)
+			{
+				sink.onAccepted(cqe.res);
+			}
+			else if (cqe.res != -ECONNABORTED && cqe.res != -EINTR && cqe.res != -ECANCELED)
+			{
+				sink.onFailure(" accept()");
+			}
+			if (!(cqe.flags & IORING_CQE_F_MORE) && listenSocket != -1)
+			{
+				acceptAll();
+			}
+			return;
+		}
+
+		const auto iterator = channels.find(id);
+		if (iterator == channels.end())
+		{
+			if (cqe.flags & IORING_CQE_F_BUFFER)
+			{
+				buffers.recycle((std::uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT));
+			}
+			return;
+		}
+		auto& channel = iterator->second;
+		switch (operation)
+		{
+		case Receive:
+			received(id, channel, cqe);
+			break;
+		case Send:
+			sent(id, channel, cqe.res);
+			channel.operations--;
+			break;
+		case Update:
+			if (cqe.res < 0)
+			{
+				channel.fixed = false;
+			}
+			break;
+		default:
+			break;
+		}
+		release(id);
+	}
+
+	void received(std::uint64_t id, Channel& channel, const io_uring_cqe& cqe)
+	{
+		const auto armed = (cqe.flags & IORING_CQE_F_MORE) != 0;
+		if (cqe.flags & IORING_CQE_F_BUFFER)
+		{
+			const auto buffer = (std::uint16_t)(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+			if (cqe.res > 0 && channel.connection)
+			{
+				sink.onReceived(*channel.connection, buffers.take(buffer, (size_t)cqe.res));
+			}
+			buffers.recycle(buffer);
+		}
+		if (channel.connection && (cqe.res == 0 || cqe.res == -ECONNRESET || cqe.res == -EPIPE))
+		{
+			sink.onClosed(*channel.connection); //     
+		}
+		else if (channel.connection && cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED)
+		{
+			sink.onFailure(" recv()");
+			sink.onClosed(*channel.connection);
+		}
+		if (!armed)
+		{
+			//   recv       resume
+			channel.receiving = false;
+			if (channel.connection && !channel.connection->paused)
+			{
+				receive(id, channel);
+			}
+			channel.operations--;
+		}
+	}
+
+	void sent(std::uint64_t id, Channel& channel, int result)
+	{
+		channel.outgoing.clear();
+		if (!channel.connection)
+		{
+			return;
+		}
+		if (result > 0)
+		{
+			sink.onWritten(*channel.connection, (size_t)result);
+		}
+		else if (result != -EAGAIN && result != -EINTR)
+		{
+			sink.onClosed(*channel.connection);
+		}
+		if (channel.connection)
+		{
+			transmit(id, channel);
+		}
+	}
+};
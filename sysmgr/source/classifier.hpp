@@ -0,0 +1,453 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstring>
+#include <algorithm>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <span>
+#include <unordered_map>
+#include <fstream>
+#include <sstream>
+#include <filesystem>
+#include <system_error>
+
+#include "folders.hpp"
+
+
+enum class CFolderType : int
+{
+	Default = 0x1000,
+	Programs = 0x1001,
+	Projects = 0x1002,
+	Documents = 0x1003,
+	Pictures = 0x1004,
+	Music = 0x1005,
+	Videos = 0x1006,
+};
+
+using CFolderCounts = std::array<std::uint32_t, 6>;
+
+struct CFolderSample
+{
+	std::int64_t Time = 0;
+	CFolderCounts Counts{};
+	bool Project = false;
+};
+
+class CClassifierCache
+{
+private:
+	static constexpr std::string_view _Header = "sysmgr-classifier 2";
+
+	std::unordered_map<std::filesystem::path::string_type, CFolderSample> _Entries;
+public:
+	const CFolderSample* Find(const std::filesystem::path& Folder, std::int64_t Time) const noexcept
+	{
+		const auto Iterator = this->_Entries.find(Folder.native());
+		return (Iterator != this->_Entries.end() && Iterator->second.Time == Time) ? &Iterator->second : nullptr;
+	}
+
+	// Replaces everything cached below Root with the samples of the latest walk
+	void Update(const std::filesystem::path& Root, std::vector<std::pair<std::filesystem::path, CFolderSample>>&& Samples)
+	{
+		const auto& Prefix = Root.native();
+		std::erase_if(this->_Entries, [&](const auto& Entry) {
+			const auto& Key = Entry.first;
+			return Key.starts_with(Prefix) && (Key.size() == Prefix.size() || _IsSeparator(Key[Prefix.size()]) || _IsSeparator(Prefix.back()));
+		});
+		for (auto& [Folder, Sample] : Samples)
+		{
+			this->_Entries.insert_or_assign(std::move(Folder).native(), Sample);
+		}
+	}
+
+	// Restamps folders the batch has just written desktop.ini into, so the next walk still hits the cache
+	void Refresh(std::span<const CFolderAssignment> Folders)
+	{
+		for (const auto& Folder : Folders)
+		{
+			const auto Iterator = this->_Entries.find(Folder.Folder.native());
+			std::error_code Error;
+			const auto Time = std::filesystem::last_write_time(Folder.Folder, Error);
+			if (Iterator != this->_Entries.end() && !Error)
+			{
+				Iterator->second.Time = (std::int64_t)Time.time_since_epoch().count();
+			}
+		}
+	}
+
+	size_t Size() const noexcept
+	{
+		return this->_Entries.size();
+	}
+
+	bool Load(const std::filesystem::path& FileName)
+	{
+		this->_Entries.clear();
+		std::ifstream File(FileName, std::ios::binary);
+		std::string Line;
+		if (!File || !std::getline(File, Line) || Line != _Header)
+		{
+			return false;
+		}
+		while (std::getline(File, Line))
+		{
+			std::istringstream Stream(Line);
+			CFolderSample Sample;
+			Stream >> Sample.Time >> Sample.Project;
+			for (auto& Count : Sample.Counts)
+			{
+				Stream >> Count;
+			}
+			if (!Stream || Stream.get() != ' ')
+			{
+				continue;
+			}
+			const auto Offset = (size_t)Stream.tellg();
+			const std::u8string Folder(Line.begin() + Offset, Line.end());
+			this->_Entries.insert_or_assign(std::filesystem::path(Folder).native(), Sample);
+		}
+		return true;
+	}
+
+	bool Save(const std::filesystem::path& FileName) const
+	{
+		std::error_code Error;
+		std::filesystem::create_directories(FileName.parent_path(), Error);
+		auto Temporary = FileName;
+		Temporary += ".tmp";
+		{
+			std::ofstream File(Temporary, std::ios::binary | std::ios::trunc);
+			File << _Header << '\n';
+			for (const auto& [Folder, Sample] : this->_Entries)
+			{
+				File << Sample.Time << ' ' << Sample.Project;
+				for (const auto Count : Sample.Counts)
+				{
+					File << ' ' << Count;
+				}
+				const auto Name = std::filesystem::path(Folder).u8string();
+				File << ' ' << std::string_view((const char*)Name.data(), Name.size()) << '\n';
+			}
+			if (!File.flush())
+			{
+				return false;
+			}
+		}
+		std::filesystem::rename(Temporary, FileName, Error);
+		return !Error;
+	}
+private:
+	static bool _IsSeparator(std::filesystem::path::value_type Char) noexcept
+	{
+		return Char == '/' || Char == std::filesystem::path::preferred_separator;
+	}
+};
+
+struct CClassifierOptions
+{
+	int MaxDepth = -1;
+	unsigned Threads = 0;
+	size_t SampleFiles = 64;
+	size_t MagicReads = 8;
+	size_t MinSamples = 3;
+	double Threshold = 0.5;
+	std::stop_token Stop;
+};
+
+struct CClassifierResult
+{
+	std::vector<CFolderAssignment> Folders;
+	size_t Scanned = 0;
+	size_t Cached = 0;
+	std::vector<std::filesystem::path> Failed;
+};
+
+class CFolderClassifier
+{
+private:
+	struct CVisited
+	{
+		std::filesystem::path Folder;
+		int Depth = 0;
+		CFolderSample Sample;
+		bool Cached = false;
+	};
+
+	CClassifierOptions _Options;
+public:
+	explicit CFolderClassifier(const CClassifierOptions& Options = {}) : _Options{ Options }
+	{
+	}
+
+	// The whole tree is sampled even with MaxDepth >= 0: a folder is classified by its own files and those of all subfolders
+	CClassifierResult Classify(const std::filesystem::path& Root, CClassifierCache& Cache) const
+	{
+		const auto Threads = this->_Options.Threads ? this->_Options.Threads : CParallelWalker::DefaultThreads();
+		struct alignas(64) CSlot
+		{
+			std::vector<CVisited> Visited;
+			std::vector<std::filesystem::path> Failed;
+		};
+		std::vector<CSlot> Slots(Threads);
+
+		CParallelWalker().Run(Root, -1, Threads,
+			[&](const std::filesystem::path& Folder, int Depth, unsigned Worker) {
+				auto& Visited = Slots[Worker].Visited.emplace_back(CVisited{ .Folder = Folder, .Depth = Depth, .Sample = {}, .Cached = false });
+				std::error_code Error;
+				const auto Time = (std::int64_t)std::filesystem::last_write_time(Folder, Error).time_since_epoch().count();
+				if (const auto Sample = Error ? nullptr : Cache.Find(Folder, Time))
+				{
+					Visited.Sample = *Sample;
+					Visited.Cached = true;
+					return;
+				}
+				Visited.Sample.Time = Error ? 0 : Time;
+				this->_Sample(Folder, Visited.Sample);
+			},
+			[&](const std::filesystem::path& Folder, std::error_code, unsigned Worker) {
+				Slots[Worker].Failed.push_back(Folder);
+			},
+			this->_Options.Stop);
+
+		CClassifierResult Result;
+		// A partial walk would make Update drop the cache of the folders it never reached
+		if (this->_Options.Stop.stop_requested())
+		{
+			return Result;
+		}
+		std::vector<CVisited> Visited;
+		for (auto& Slot : Slots)
+		{
+			std::move(Slot.Visited.begin(), Slot.Visited.end(), std::back_inserter(Visited));
+			std::move(Slot.Failed.begin(), Slot.Failed.end(), std::back_inserter(Result.Failed));
+		}
+		std::sort(Visited.begin(), Visited.end(), [](const CVisited& Left, const CVisited& Right) { return Left.Depth > Right.Depth; });
+
+		std::unordered_map<std::filesystem::path::string_type, size_t> Index;
+		for (size_t i = 0; i != Visited.size(); i++)
+		{
+			Index.emplace(Visited[i].Folder.native(), i);
+		}
+
+		std::vector<CFolderCounts> Totals(Visited.size());
+		std::vector<std::pair<std::filesystem::path, CFolderSample>> Samples;
+		Samples.reserve(Visited.size());
+		for (size_t i = 0; i != Visited.size(); i++)
+		{
+			auto& Item = Visited[i];
+			for (size_t Type = 0; Type != Totals[i].size(); Type++)
+			{
+				Totals[i][Type] += Item.Sample.Counts[Type];
+			}
+			if (Item.Depth > 0)
+			{
+				const auto Parent = (Item.Depth == 1) ? Index.find(Root.native()) : Index.find(Item.Folder.parent_path().native());
+				if (Parent != Index.end())
+				{
+					for (size_t Type = 0; Type != Totals[i].size(); Type++)
+					{
+						Totals[Parent->second][Type] += Totals[i][Type];
+					}
+				}
+			}
+
+			(Item.Cached ? Result.Cached : Result.Scanned)++;
+			if (this->_Options.MaxDepth < 0 || Item.Depth <= this->_Options.MaxDepth)
+			{
+				Result.Folders.push_back({ Item.Folder, (int)(Item.Sample.Project ? CFolderType::Projects : this->_Decide(Totals[i])) });
+			}
+			if (Item.Sample.Time != 0)
+			{
+				Samples.emplace_back(std::move(Item.Folder), Item.Sample);
+			}
+		}
+
+		Cache.Update(Root, std::move(Samples));
+		return Result;
+	}
+private:
+	CFolderType _Decide(const CFolderCounts& Counts) const noexcept
+	{
+		std::uint64_t Total = 0;
+		size_t Best = 0;
+		for (size_t Type = 0; Type != Counts.size(); Type++)
+		{
+			Total += Counts[Type];
+			if (Counts[Type] > Counts[Best])
+			{
+				Best = Type;
+			}
+		}
+		if (Total < this->_Options.MinSamples || Counts[Best] < this->_Options.Threshold * (double)Total)
+		{
+			return CFolderType::Default;
+		}
+		return (CFolderType)((int)CFolderType::Programs + (int)Best);
+	}
+
+	void _Sample(const std::filesystem::path& Folder, CFolderSample& Sample) const
+	{
+		auto& Counts = Sample.Counts;
+		size_t Files = 0, Reads = 0;
+		std::error_code Error;
+		std::filesystem::directory_iterator Iterator(Folder, std::filesystem::directory_options::skip_permission_denied, Error);
+		for (; !Error && Iterator != std::filesystem::directory_iterator(); Iterator.increment(Error))
+		{
+			const auto& Path = Iterator->path();
+			const auto Name = _Lower(Path.filename().u16string());
+			std::error_code StatusError;
+			if (Iterator->is_directory(StatusError))
+			{
+				Sample.Project |= (Name == u".git" || Name == u".svn" || Name == u".vs");
+				continue;
+			}
+			if (!Iterator->is_regular_file(StatusError) || Name == u"desktop.ini" || Name == u"thumbs.db")
+			{
+				continue;
+			}
+
+			// Markers are looked for past the SampleFiles budget, the budget only caps what gets counted
+			Sample.Project |= _IsMarker(Name);
+			if (Files == this->_Options.SampleFiles)
+			{
+				continue;
+			}
+			Files++;
+			auto Type = _ByName(Name);
+			// .ts is TypeScript unless the header has the MPEG-TS sync bytes
+			const auto Ambiguous = Name.ends_with(u".ts");
+			if ((Type == CFolderType::Default || Ambiguous) && Reads < this->_Options.MagicReads)
+			{
+				Reads++;
+				const auto Magic = _ByMagic(Path);
+				Type = (Type == CFolderType::Default || Magic == CFolderType::Videos) ? Magic : Type;
+			}
+			if (Type != CFolderType::Default)
+			{
+				Counts[_Slot(Type)]++;
+			}
+		}
+	}
+
+	static size_t _Slot(CFolderType Type) noexcept
+	{
+		return (size_t)((int)Type - (int)CFolderType::Programs);
+	}
+
+	static std::u16string _Lower(std::u16string Value)
+	{
+		for (auto& Char : Value)
+		{
+			if (Char >= u'A' && Char <= u'Z')
+			{
+				Char = (char16_t)(Char + 32);
+			}
+		}
+		return Value;
+	}
+
+	static bool _IsMarker(std::u16string_view Name) noexcept
+	{
+		static constexpr std::u16string_view Markers[]{
+			u"cmakelists.txt", u"makefile", u"package.json", u"cargo.toml", u"go.mod", u"pom.xml", u"build.gradle", u"pyproject.toml", u"meson.build",
+		};
+		return std::find(std::begin(Markers), std::end(Markers), Name) != std::end(Markers);
+	}
+
+	static CFolderType _ByName(std::u16string_view Name) noexcept
+	{
+		static constexpr std::pair<std::u16string_view, CFolderType> Extensions[]{
+			{ u"exe", CFolderType::Programs }, { u"dll", CFolderType::Programs }, { u"msi", CFolderType::Programs }, { u"sys", CFolderType::Programs },
+			{ u"so", CFolderType::Programs }, { u"appimage", CFolderType::Programs }, { u"deb", CFolderType::Programs }, { u"rpm", CFolderType::Programs },
+
+			{ u"c", CFolderType::Projects }, { u"cc", CFolderType::Projects }, { u"cpp", CFolderType::Projects }, { u"cxx", CFolderType::Projects },
+			{ u"h", CFolderType::Projects }, { u"hpp", CFolderType::Projects }, { u"cs", CFolderType::Projects }, { u"java", CFolderType::Projects },
+			{ u"py", CFolderType::Projects }, { u"js", CFolderType::Projects }, { u"ts", CFolderType::Projects }, { u"rs", CFolderType::Projects },
+			{ u"go", CFolderType::Projects }, { u"sln", CFolderType::Projects }, { u"vcxproj", CFolderType::Projects }, { u"csproj", CFolderType::Projects },
+
+			{ u"pdf", CFolderType::Documents }, { u"doc", CFolderType::Documents }, { u"docx", CFolderType::Documents }, { u"xls", CFolderType::Documents },
+			{ u"xlsx", CFolderType::Documents }, { u"ppt", CFolderType::Documents }, { u"pptx", CFolderType::Documents }, { u"odt", CFolderType::Documents },
+			{ u"ods", CFolderType::Documents }, { u"rtf", CFolderType::Documents }, { u"txt", CFolderType::Documents }, { u"djvu", CFolderType::Documents },
+			{ u"epub", CFolderType::Documents }, { u"fb2", CFolderType::Documents },
+
+			{ u"jpg", CFolderType::Pictures }, { u"jpeg", CFolderType::Pictures }, { u"png", CFolderType::Pictures }, { u"gif", CFolderType::Pictures },
+			{ u"bmp", CFolderType::Pictures }, { u"tif", CFolderType::Pictures }, { u"tiff", CFolderType::Pictures }, { u"webp", CFolderType::Pictures },
+			{ u"heic", CFolderType::Pictures }, { u"raw", CFolderType::Pictures }, { u"cr2", CFolderType::Pictures }, { u"nef", CFolderType::Pictures },
+			{ u"dng", CFolderType::Pictures }, { u"svg", CFolderType::Pictures },
+
+			{ u"mp3", CFolderType::Music }, { u"flac", CFolderType::Music }, { u"wav", CFolderType::Music }, { u"ogg", CFolderType::Music },
+			{ u"m4a", CFolderType::Music }, { u"aac", CFolderType::Music }, { u"wma", CFolderType::Music }, { u"opus", CFolderType::Music },
+			{ u"ape", CFolderType::Music },
+
+			{ u"mp4", CFolderType::Videos }, { u"mkv", CFolderType::Videos }, { u"avi", CFolderType::Videos }, { u"mov", CFolderType::Videos },
+			{ u"wmv", CFolderType::Videos }, { u"webm", CFolderType::Videos }, { u"m4v", CFolderType::Videos }, { u"mpg", CFolderType::Videos },
+			{ u"mpeg", CFolderType::Videos }, { u"flv", CFolderType::Videos },
+		};
+
+		if (_IsMarker(Name))
+		{
+			return CFolderType::Projects;
+		}
+		const auto Dot = Name.rfind(u'.');
+		if (Dot == std::u16string_view::npos || Dot == 0)
+		{
+			return CFolderType::Default;
+		}
+		const auto Extension = Name.substr(Dot + 1);
+		for (const auto& [Key, Type] : Extensions)
+		{
+			if (Key == Extension)
+			{
+				return Type;
+			}
+		}
+		return CFolderType::Default;
+	}
+
+	static CFolderType _ByMagic(const std::filesystem::path& FileName)
+	{
+#ifdef _WIN32
+		const auto Attributes = GetFileAttributesW(FileName.c_str());
+		if (Attributes == INVALID_FILE_ATTRIBUTES || (Attributes & (FILE_ATTRIBUTE_OFFLINE | FILE_ATTRIBUTE_RECALL_ON_OPEN | FILE_ATTRIBUTE_RECALL_ON_DATA_ACCESS)))
+		{
+			return CFolderType::Default;
+		}
+#endif
+		char Data[192]{};
+		std::ifstream File(FileName, std::ios::binary);
+		File.read(Data, sizeof(Data));
+		const auto Size = (size_t)File.gcount();
+		const auto Is = [&](size_t Offset, std::string_view Magic) {
+			return Offset + Magic.size() <= Size && std::memcmp(Data + Offset, Magic.data(), Magic.size()) == 0;
+		};
+
+		if (Is(0, "MZ") || Is(0, "\x7F" "ELF"))
+		{
+			return CFolderType::Programs;
+		}
+		if (Is(0, "%PDF") || Is(0, "\xD0\xCF\x11\xE0") || Is(0, "{\\rtf") || Is(0, "AT&TFORM"))
+		{
+			return CFolderType::Documents;
+		}
+		if (Is(0, "\x89PNG") || Is(0, "\xFF\xD8\xFF") || Is(0, "GIF8") || Is(0, std::string_view("II*\0", 4)) || Is(0, std::string_view("MM\0*", 4)) ||
+			(Is(0, "RIFF") && Is(8, "WEBP")) || (Is(4, "ftyp") && (Is(8, "heic") || Is(8, "avif"))))
+		{
+			return CFolderType::Pictures;
+		}
+		if (Is(0, "ID3") || Is(0, "\xFF\xFB") || Is(0, "\xFF\xF3") || Is(0, "fLaC") || Is(0, "OggS") ||
+			(Is(0, "RIFF") && Is(8, "WAVE")) || (Is(4, "ftyp") && Is(8, "M4A ")))
+		{
+			return CFolderType::Music;
+		}
+		if (Is(0, "\x1A\x45\xDF\xA3") || (Is(0, "RIFF") && Is(8, "AVI ")) || Is(4, "ftyp") || Is(0, std::string_view("\0\0\1\xBA", 4)) || (Is(0, "\x47") && Is(188, "\x47")))
+		{
+			return CFolderType::Videos;
+		}
+		return CFolderType::Default;
+	}
+};
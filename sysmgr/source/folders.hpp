@@ -0,0 +1,615 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <atomic>
+#include <thread>
+#include <stop_token>
+#include <fstream>
+#include <iterator>
+#include <algorithm>
+#include <functional>
+#include <span>
+#include <filesystem>
+#include <system_error>
+
+#ifdef _WIN32
+#include <windows.h>
+#endif
+
+
+class CDesktopIni
+{
+private:
+	static constexpr std::u16string_view _Section = u"[.ShellClassInfo]";
+
+	std::filesystem::path _FileName;
+	std::vector<std::u16string> _Lines;
+	bool _Exists = false;
+	bool _Unicode = false;
+	bool _Raw = false;
+	bool _Modified = false;
+public:
+	bool Load(const std::filesystem::path& Folder, std::error_code& Error)
+	{
+		this->_FileName = Folder / "desktop.ini";
+		this->_Lines.clear();
+		this->_Exists = std::filesystem::is_regular_file(this->_FileName, Error);
+		this->_Unicode = false;
+		this->_Raw = false;
+		this->_Modified = false;
+		if (Error || !this->_Exists)
+		{
+			Error.clear();
+			return true;
+		}
+
+		std::ifstream File(this->_FileName, std::ios::binary);
+		const std::string Bytes{ std::istreambuf_iterator<char>(File), std::istreambuf_iterator<char>() };
+		if (File.bad())
+		{
+			Error = std::make_error_code(std::errc::io_error);
+			return false;
+		}
+
+		std::u16string Text;
+		if (Bytes.size() >= 2 && (unsigned char)Bytes[0] == 0xFF && (unsigned char)Bytes[1] == 0xFE)
+		{
+			this->_Unicode = true;
+			for (size_t i = 2; i + 1 < Bytes.size(); i += 2)
+			{
+				Text.push_back((char16_t)((unsigned char)Bytes[i] | ((unsigned char)Bytes[i + 1] << 8)));
+			}
+		}
+		else
+		{
+			Text = _Widen(Bytes);
+			this->_Raw = std::any_of(Text.begin(), Text.end(), [](char16_t Char) { return Char >= 0x80; });
+		}
+
+		size_t Begin = 0;
+		while (Begin < Text.size())
+		{
+			auto End = Text.find(u'\n', Begin);
+			if (End == std::u16string::npos)
+			{
+				End = Text.size();
+			}
+			auto Line = Text.substr(Begin, End - Begin);
+			if (!Line.empty() && Line.back() == u'\r')
+			{
+				Line.pop_back();
+			}
+			this->_Lines.push_back(std::move(Line));
+			Begin = End + 1;
+		}
+		return true;
+	}
+
+	// false: the value needs Unicode, but the existing ANSI lines cannot be converted without corrupting them
+	bool Set(std::u16string_view Key, std::u16string_view Value)
+	{
+		if (!this->_Unicode && std::any_of(Value.begin(), Value.end(), [](char16_t Char) { return Char >= 0x80; }))
+		{
+#ifndef _WIN32
+			if (this->_Raw)
+			{
+				return false;
+			}
+#endif
+			this->_Unicode = true;
+		}
+
+		const auto [Begin, End] = this->_FindSection();
+		std::u16string Line{ Key };
+		Line += u'=';
+		Line += Value;
+
+		if (Begin == End)
+		{
+			if (!this->_Lines.empty() && !this->_Lines.back().empty())
+			{
+				this->_Lines.emplace_back();
+			}
+			this->_Lines.emplace_back(_Section);
+			this->_Lines.push_back(std::move(Line));
+			this->_Modified = true;
+			return true;
+		}
+
+		for (auto i = Begin + 1; i != End; i++)
+		{
+			if (_IsKey(this->_Lines[i], Key))
+			{
+				if (this->_Lines[i] != Line)
+				{
+					this->_Lines[i] = std::move(Line);
+					this->_Modified = true;
+				}
+				return true;
+			}
+		}
+
+		auto Position = End;
+		while (Position > Begin + 1 && _Trim(this->_Lines[Position - 1]).empty())
+		{
+			Position--;
+		}
+		this->_Lines.insert(this->_Lines.begin() + Position, std::move(Line));
+		this->_Modified = true;
+		return true;
+	}
+
+	void Remove(std::u16string_view Key)
+	{
+		const auto [Begin, End] = this->_FindSection();
+		for (auto i = Begin + (Begin != End); i < End; i++)
+		{
+			if (_IsKey(this->_Lines[i], Key))
+			{
+				this->_Lines.erase(this->_Lines.begin() + i);
+				this->_Modified = true;
+				return;
+			}
+		}
+	}
+
+	bool Modified() const noexcept
+	{
+		return this->_Modified;
+	}
+
+	bool Save(std::error_code& Error)
+	{
+		if (!this->_Modified)
+		{
+			return true;
+		}
+
+		const auto Empty = std::all_of(this->_Lines.begin(), this->_Lines.end(), [](const std::u16string& Line) {
+			const auto Value = _Trim(Line);
+			return Value.empty() || Value.front() == u'[';
+		});
+
+#ifdef _WIN32
+		if (this->_Exists)
+		{
+			SetFileAttributesW(this->_FileName.c_str(), FILE_ATTRIBUTE_NORMAL);
+		}
+#endif
+		if (Empty)
+		{
+			if (this->_Exists && !std::filesystem::remove(this->_FileName, Error))
+			{
+				return false;
+			}
+			this->_Exists = false;
+			this->_Modified = false;
+			return true;
+		}
+
+		std::string Bytes;
+		if (this->_Unicode)
+		{
+			Bytes += "\xFF\xFE";
+			for (const auto& Line : this->_Lines)
+			{
+				for (const auto Char : Line + u"\r\n")
+				{
+					Bytes.push_back((char)(Char & 0xFF));
+					Bytes.push_back((char)(Char >> 8));
+				}
+			}
+		}
+		else
+		{
+			for (const auto& Line : this->_Lines)
+			{
+				Bytes += _Narrow(Line);
+				Bytes += "\r\n";
+			}
+		}
+
+		std::ofstream File(this->_FileName, std::ios::binary | std::ios::trunc);
+		if (!File.write(Bytes.data(), (std::streamsize)Bytes.size()) || !File.flush())
+		{
+			Error = std::make_error_code(std::errc::io_error);
+			return false;
+		}
+		File.close();
+
+#ifdef _WIN32
+		SetFileAttributesW(this->_FileName.c_str(), FILE_ATTRIBUTE_HIDDEN | FILE_ATTRIBUTE_SYSTEM);
+		const auto Folder = this->_FileName.parent_path();
+		const auto Attributes = GetFileAttributesW(Folder.c_str());
+		if (Attributes != INVALID_FILE_ATTRIBUTES && !(Attributes & (FILE_ATTRIBUTE_READONLY | FILE_ATTRIBUTE_SYSTEM)))
+		{
+			SetFileAttributesW(Folder.c_str(), Attributes | FILE_ATTRIBUTE_READONLY);
+		}
+#endif
+		this->_Exists = true;
+		this->_Modified = false;
+		return true;
+	}
+private:
+	std::pair<size_t, size_t> _FindSection() const noexcept
+	{
+		for (size_t i = 0; i != this->_Lines.size(); i++)
+		{
+			if (_Equal(_Trim(this->_Lines[i]), _Section))
+			{
+				auto End = i + 1;
+				while (End != this->_Lines.size() && !_Trim(this->_Lines[End]).starts_with(u'['))
+				{
+					End++;
+				}
+				return { i, End };
+			}
+		}
+		return { this->_Lines.size(), this->_Lines.size() };
+	}
+
+	// ANSI files are decoded with the system code page on Windows; elsewhere the bytes are kept as is and written back unchanged
+	static std::u16string _Widen(const std::string& Bytes)
+	{
+#ifdef _WIN32
+		std::wstring Wide(Bytes.size(), L'\0');
+		Wide.resize((size_t)MultiByteToWideChar(CP_ACP, 0, Bytes.data(), (int)Bytes.size(), Wide.data(), (int)Wide.size()));
+		return { Wide.begin(), Wide.end() };
+#else
+		std::u16string Text;
+		for (const auto Byte : Bytes)
+		{
+			Text.push_back((char16_t)(unsigned char)Byte);
+		}
+		return Text;
+#endif
+	}
+
+	static std::string _Narrow(const std::u16string& Text)
+	{
+#ifdef _WIN32
+		const std::wstring Wide(Text.begin(), Text.end());
+		std::string Bytes((size_t)WideCharToMultiByte(CP_ACP, 0, Wide.data(), (int)Wide.size(), nullptr, 0, nullptr, nullptr), '\0');
+		WideCharToMultiByte(CP_ACP, 0, Wide.data(), (int)Wide.size(), Bytes.data(), (int)Bytes.size(), nullptr, nullptr);
+		return Bytes;
+#else
+		std::string Bytes;
+		for (const auto Char : Text)
+		{
+			Bytes.push_back((char)(Char & 0xFF));
+		}
+		return Bytes;
+#endif
+	}
+
+	static std::u16string_view _Trim(std::u16string_view Value) noexcept
+	{
+		while (!Value.empty() && (Value.front() == u' ' || Value.front() == u'\t'))
+		{
+			Value.remove_prefix(1);
+		}
+		while (!Value.empty() && (Value.back() == u' ' || Value.back() == u'\t'))
+		{
+			Value.remove_suffix(1);
+		}
+		return Value;
+	}
+
+	static bool _Equal(std::u16string_view Left, std::u16string_view Right) noexcept
+	{
+		const auto Lower = [](char16_t Char) { return (Char >= u'A' && Char <= u'Z') ? (char16_t)(Char + 32) : Char; };
+		return Left.size() == Right.size() && std::equal(Left.begin(), Left.end(), Right.begin(), [&](char16_t A, char16_t B) { return Lower(A) == Lower(B); });
+	}
+
+	static bool _IsKey(std::u16string_view Line, std::u16string_view Key) noexcept
+	{
+		const auto Separator = Line.find(u'=');
+		return Separator != std::u16string_view::npos && _Equal(_Trim(Line.substr(0, Separator)), Key);
+	}
+};
+
+class CParallelWalker
+{
+public:
+	using CVisitor = std::function<void(const std::filesystem::path& Folder, int Depth, unsigned Worker)>;
+	using CErrorHandler = std::function<void(const std::filesystem::path& Folder, std::error_code Error, unsigned Worker)>;
+private:
+	struct CItem
+	{
+		std::filesystem::path Folder;
+		int Depth = 0;
+	};
+
+	struct alignas(64) CQueue
+	{
+		std::mutex Lock;
+		std::deque<CItem> Items;
+	};
+
+	std::vector<CQueue> _Queues;
+	std::atomic<size_t> _Pending{ 0 };
+	int _MaxDepth = -1;
+public:
+	static unsigned DefaultThreads() noexcept
+	{
+		return std::max(std::thread::hardware_concurrency(), 1u);
+	}
+
+	// MaxDepth < 0 walks the whole tree, 0 visits only Root; a stop request abandons the folders still queued
+	void Run(const std::filesystem::path& Root, int MaxDepth, unsigned Threads, const CVisitor& Visitor, const CErrorHandler& OnError, std::stop_token Stop = {})
+	{
+		Threads = Threads ? Threads : DefaultThreads();
+		this->_Queues = std::vector<CQueue>(Threads);
+		this->_MaxDepth = MaxDepth;
+		this->_Pending = 1;
+		this->_Queues[0].Items.push_back({ Root, 0 });
+
+		std::vector<std::thread> Workers;
+		for (unsigned i = 1; i < Threads; i++)
+		{
+			Workers.emplace_back([&, i]() { this->_Work(i, Visitor, OnError, Stop); });
+		}
+		this->_Work(0, Visitor, OnError, Stop);
+		for (auto& Worker : Workers)
+		{
+			Worker.join();
+		}
+		this->_Queues.clear();
+	}
+private:
+	void _Work(unsigned Worker, const CVisitor& Visitor, const CErrorHandler& OnError, const std::stop_token& Stop)
+	{
+		CItem Item;
+		while (this->_Pending.load(std::memory_order_acquire) != 0 && !Stop.stop_requested())
+		{
+			if (!this->_Pop(Worker, Item) && !this->_Steal(Worker, Item))
+			{
+				std::this_thread::yield();
+				continue;
+			}
+
+			Visitor(Item.Folder, Item.Depth, Worker);
+			if (this->_MaxDepth < 0 || Item.Depth < this->_MaxDepth)
+			{
+				this->_Expand(Worker, Item, OnError);
+			}
+			this->_Pending.fetch_sub(1, std::memory_order_acq_rel);
+		}
+	}
+
+	void _Expand(unsigned Worker, const CItem& Item, const CErrorHandler& OnError)
+	{
+		std::error_code Error;
+		std::filesystem::directory_iterator Iterator(Item.Folder, std::filesystem::directory_options::skip_permission_denied, Error);
+		std::vector<CItem> Children;
+		for (; !Error && Iterator != std::filesystem::directory_iterator(); Iterator.increment(Error))
+		{
+			std::error_code StatusError;
+			if (Iterator->is_directory(StatusError) && !Iterator->is_symlink(StatusError))
+			{
+				Children.push_back({ Iterator->path(), Item.Depth + 1 });
+			}
+		}
+		if (Error)
+		{
+			OnError(Item.Folder, Error, Worker);
+		}
+		if (Children.empty())
+		{
+			return;
+		}
+
+		this->_Pending.fetch_add(Children.size(), std::memory_order_acq_rel);
+		auto& Queue = this->_Queues[Worker];
+		std::lock_guard Lock(Queue.Lock);
+		for (auto& Child : Children)
+		{
+			Queue.Items.push_back(std::move(Child));
+		}
+	}
+
+	bool _Pop(unsigned Worker, CItem& Item)
+	{
+		auto& Queue = this->_Queues[Worker];
+		std::lock_guard Lock(Queue.Lock);
+		if (Queue.Items.empty())
+		{
+			return false;
+		}
+		Item = std::move(Queue.Items.back());
+		Queue.Items.pop_back();
+		return true;
+	}
+
+	bool _Steal(unsigned Worker, CItem& Item)
+	{
+		const auto Count = (unsigned)this->_Queues.size();
+		for (unsigned i = 1; i < Count; i++)
+		{
+			auto& Queue = this->_Queues[(Worker + i) % Count];
+			std::unique_lock Lock(Queue.Lock, std::try_to_lock);
+			if (Lock && !Queue.Items.empty())
+			{
+				Item = std::move(Queue.Items.front());
+				Queue.Items.pop_front();
+				return true;
+			}
+		}
+		return false;
+	}
+};
+
+struct CFolderRule
+{
+	std::filesystem::path Module;
+	int ResourceID = 0;
+	bool Icon = true;
+	bool LocalizedName = true;
+};
+
+struct CFolderAssignment
+{
+	std::filesystem::path Folder;
+	int ResourceID = 0;
+};
+
+struct CFolderBatchOptions
+{
+	int MaxDepth = -1;
+	unsigned Threads = 0;
+	std::stop_token Stop;
+};
+
+struct CFolderBatchResult
+{
+	size_t Folders = 0;
+	size_t Changed = 0;
+	std::vector<std::filesystem::path> Failed;
+
+	void Merge(CFolderBatchResult&& Other)
+	{
+		this->Folders += Other.Folders;
+		this->Changed += Other.Changed;
+		std::move(Other.Failed.begin(), Other.Failed.end(), std::back_inserter(this->Failed));
+	}
+};
+
+class CFolderBatch
+{
+public:
+	// ResourceID == 0 removes the customization written by a previous run
+	static CFolderBatchResult Apply(const std::filesystem::path& Root, const CFolderRule& Rule, const CFolderBatchOptions& Options = {})
+	{
+		const auto Threads = Options.Threads ? Options.Threads : CParallelWalker::DefaultThreads();
+		const auto Resource = Rule.Module.u16string() + u",-" + _ToU16(Rule.ResourceID);
+
+		struct alignas(64) CSlot
+		{
+			CFolderBatchResult Result;
+		};
+		std::vector<CSlot> Slots(Threads);
+
+		CParallelWalker().Run(Root, Options.MaxDepth, Threads,
+			[&](const std::filesystem::path& Folder, int, unsigned Worker) {
+				auto& Result = Slots[Worker].Result;
+				Result.Folders++;
+				if (const auto Changed = _ApplyTo(Folder, Rule, Resource); Changed < 0)
+				{
+					Result.Failed.push_back(Folder);
+				}
+				else
+				{
+					Result.Changed += Changed;
+				}
+			},
+			[&](const std::filesystem::path& Folder, std::error_code, unsigned Worker) {
+				Slots[Worker].Result.Failed.push_back(Folder);
+			},
+			Options.Stop);
+
+		CFolderBatchResult Result;
+		for (auto& Slot : Slots)
+		{
+			Result.Merge(std::move(Slot.Result));
+		}
+		return Result;
+	}
+
+	// Applies a separate resource to each folder, Rule supplies the module and the keys to write
+	static CFolderBatchResult Apply(std::span<const CFolderAssignment> Folders, const CFolderRule& Rule, unsigned Threads = 0, std::stop_token Stop = {})
+	{
+		Threads = std::min<unsigned>(Threads ? Threads : CParallelWalker::DefaultThreads(), (unsigned)std::max<size_t>(Folders.size(), 1));
+		const auto Module = Rule.Module.u16string() + u",-";
+
+		struct alignas(64) CSlot
+		{
+			CFolderBatchResult Result;
+		};
+		std::vector<CSlot> Slots(Threads);
+		std::atomic<size_t> Next{ 0 };
+		const auto Work = [&](unsigned Worker) {
+			auto& Result = Slots[Worker].Result;
+			for (auto i = Next++; i < Folders.size() && !Stop.stop_requested(); i = Next++)
+			{
+				auto FolderRule = Rule;
+				FolderRule.ResourceID = Folders[i].ResourceID;
+				Result.Folders++;
+				if (const auto Changed = _ApplyTo(Folders[i].Folder, FolderRule, Module + _ToU16(FolderRule.ResourceID)); Changed < 0)
+				{
+					Result.Failed.push_back(Folders[i].Folder);
+				}
+				else
+				{
+					Result.Changed += Changed;
+				}
+			}
+		};
+
+		std::vector<std::thread> Workers;
+		for (unsigned i = 1; i < Threads; i++)
+		{
+			Workers.emplace_back(Work, i);
+		}
+		Work(0);
+		for (auto& Worker : Workers)
+		{
+			Worker.join();
+		}
+
+		CFolderBatchResult Result;
+		for (auto& Slot : Slots)
+		{
+			Result.Merge(std::move(Slot.Result));
+		}
+		return Result;
+	}
+private:
+	static int _ApplyTo(const std::filesystem::path& Folder, const CFolderRule& Rule, const std::u16string& Resource)
+	{
+		std::error_code Error;
+		CDesktopIni Ini;
+		if (!Ini.Load(Folder, Error))
+		{
+			return -1;
+		}
+
+		if (Rule.Icon)
+		{
+			Ini.Remove(u"IconFile");
+			Ini.Remove(u"IconIndex");
+			if (!Rule.ResourceID)
+			{
+				Ini.Remove(u"IconResource");
+			}
+			else if (!Ini.Set(u"IconResource", Resource))
+			{
+				return -1;
+			}
+		}
+		if (Rule.LocalizedName)
+		{
+			if (!Rule.ResourceID)
+			{
+				Ini.Remove(u"LocalizedResourceName");
+			}
+			else if (!Ini.Set(u"LocalizedResourceName", u"@" + Resource))
+			{
+				return -1;
+			}
+		}
+
+		const auto Modified = Ini.Modified();
+		return Ini.Save(Error) ? (int)Modified : -1;
+	}
+
+	static std::u16string _ToU16(int Value)
+	{
+		const auto String = std::to_string(Value);
+		return { String.begin(), String.end() };
+	}
+};
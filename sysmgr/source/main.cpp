@@ -4,6 +4,11 @@
 class CMainDialog : public IDialogBox
 {
 private:
+	std::thread _Worker;
+	std::stop_source _Stop;
+	std::filesystem::path _Root;
+	CFolderBatchResult _Result;
+
 	bool Handler(HWND Window, UINT Message, WPARAM Param1, LPARAM Param2) noexcept override
 	{
 		const auto Module = (HINSTANCE)GetWindowLongPtr(Window, GWLP_HINSTANCE);
@@ -50,7 +55,10 @@ private:
 						TCHAR FileName[MAX_PATH]{};
 						if (HIWORD(Param1) == CBN_EDITCHANGE && CComboBox(Window, 0x0002).GetText(FileName, ARRAYSIZE(FileName)))
 						{
-							CComboBox(Window, 0x0003).Enable(PathIsDirectory(FileName));
+							const auto Enable = PathIsDirectory(FileName) && !this->_Worker.joinable();
+							CComboBox(Window, 0x0003).Enable(Enable);
+							EnableWindow(GetDlgItem(Window, 0x0004), Enable);
+							EnableWindow(GetDlgItem(Window, 0x0005), Enable);
 						}
 						return true;
 					}
@@ -59,31 +67,65 @@ private:
 					{
 						if (HIWORD(Param1) == CBN_SELENDOK)
 						{
-							TCHAR ModuleFileName[MAX_PATH]{}, Path[MAX_PATH]{}, DesktopFileName[MAX_PATH]{};
+							TCHAR ModuleFileName[MAX_PATH]{}, Path[MAX_PATH]{};
 							const auto Index = CComboBox(Window, 0x0003).GetCurSel();
 							if ((Index != CB_ERR) &&
+								!this->_Worker.joinable() &&
 								GetModuleFileName(Module, ModuleFileName, ARRAYSIZE(ModuleFileName)) &&
-								CComboBox(Window, 0x0002).GetText(Path, ARRAYSIZE(Path)) &&
-								SUCCEEDED(StringCchCopy(DesktopFileName, ARRAYSIZE(DesktopFileName), Path)) &&
-								PathAppend(DesktopFileName, TEXT("desktop.ini")))
+								CComboBox(Window, 0x0002).GetText(Path, ARRAYSIZE(Path)))
 							{
-								DeleteFile(DesktopFileName);
-								SHChangeNotify(SHCNE_DELETE, SHCNF_PATH | SHCNF_NOTIFYRECURSIVE, DesktopFileName, NULL);
-								SHChangeNotify(SHCNE_UPDATEDIR, SHCNF_PATH | SHCNF_NOTIFYRECURSIVE, Path, NULL);
-								SHChangeNotify(SHCNE_UPDATEITEM, SHCNF_PATH | SHCNF_NOTIFYRECURSIVE, Path, NULL);
-								if (Index != 0)
+								const CFolderRule Rule{
+									.Module = ModuleFileName,
+									.ResourceID = (Index != 0) ? Index + 0x1000 : 0,
+								};
+								this->_Stop = std::stop_source();
+								const CFolderBatchOptions Options{
+									.MaxDepth = (IsDlgButtonChecked(Window, 0x0004) == BST_CHECKED) ? -1 : 0,
+									.Stop = this->_Stop.get_token(),
+								};
+								this->_Root = Path;
+								this->_EnableFolderControls(Window, false);
+								this->_Worker = std::thread([this, Window, Rule, Options]() {
+									this->_Result = CFolderBatch::Apply(this->_Root, Rule, Options);
+									PostMessage(Window, WM_APP, 0, 0);
+								});
+							}
+						}
+						return true;
+					}
+
+					case 0x0005:
+					{
+						TCHAR ModuleFileName[MAX_PATH]{}, Path[MAX_PATH]{};
+						if ((HIWORD(Param1) == BN_CLICKED) &&
+							!this->_Worker.joinable() &&
+							GetModuleFileName(Module, ModuleFileName, ARRAYSIZE(ModuleFileName)) &&
+							CComboBox(Window, 0x0002).GetText(Path, ARRAYSIZE(Path)))
+						{
+							const CFolderRule Rule{
+								.Module = ModuleFileName,
+							};
+							this->_Stop = std::stop_source();
+							const CClassifierOptions Options{
+								.MaxDepth = (IsDlgButtonChecked(Window, 0x0004) == BST_CHECKED) ? -1 : 0,
+								.Stop = this->_Stop.get_token(),
+							};
+							this->_Root = Path;
+							this->_EnableFolderControls(Window, false);
+							this->_Worker = std::thread([this, Window, Rule, Options]() {
+								const auto CacheFileName = _CacheFileName();
+								CClassifierCache Cache;
+								Cache.Load(CacheFileName);
+								auto Folders = CFolderClassifier(Options).Classify(this->_Root, Cache).Folders;
+								std::erase_if(Folders, [](const CFolderAssignment& Folder) { return Folder.ResourceID == (int)CFolderType::Default; });
+								this->_Result = CFolderBatch::Apply(Folders, Rule, 0, Options.Stop);
+								Cache.Refresh(Folders);
+								if (!CacheFileName.empty())
 								{
-									const auto ResourceID = Index + 0x1000;
-									SHFOLDERCUSTOMSETTINGS FolderCustomSettings{
-										.dwSize = sizeof(FolderCustomSettings),
-										.dwMask = FCSM_ICONFILE,
-										.pszIconFile = ModuleFileName,
-										.iIconIndex = -ResourceID,
-									};
-									SHGetSetFolderCustomSettings(&FolderCustomSettings, Path, FCS_FORCEWRITE);
-									SHSetLocalizedName(Path, ModuleFileName, ResourceID);
+									Cache.Save(CacheFileName);
 								}
-							}
+								PostMessage(Window, WM_APP, 0, 0);
+							});
 						}
 						return true;
 					}
@@ -91,14 +133,55 @@ private:
 				break;
 			}
 
+			case WM_APP:
+			{
+				if (this->_Worker.joinable())
+				{
+					this->_Worker.join();
+				}
+				if (this->_Result.Changed)
+				{
+					// The root's own icon is drawn by its parent view, changes below it by the recursive UPDATEDIR
+					SHChangeNotify(SHCNE_UPDATEITEM, SHCNF_PATH | SHCNF_FLUSHNOWAIT, this->_Root.c_str(), nullptr);
+					SHChangeNotify(SHCNE_UPDATEDIR, SHCNF_PATH | SHCNF_NOTIFYRECURSIVE | SHCNF_FLUSHNOWAIT, this->_Root.c_str(), nullptr);
+				}
+				this->_EnableFolderControls(Window, true);
+				return true;
+			}
+
 			case WM_CLOSE:
 			{
+				if (this->_Worker.joinable())
+				{
+					this->_Stop.request_stop();
+					this->_Worker.join();
+				}
 				EndDialog(Window, 0);
 				return true;
 			}
 		}
 		return false;
 	}
+
+	void _EnableFolderControls(HWND Window, bool Value) noexcept
+	{
+		CComboBox(Window, 0x0002).Enable(Value);
+		CComboBox(Window, 0x0003).Enable(Value);
+		EnableWindow(GetDlgItem(Window, 0x0004), Value);
+		EnableWindow(GetDlgItem(Window, 0x0005), Value);
+	}
+
+	static std::filesystem::path _CacheFileName()
+	{
+		PWSTR Folder = nullptr;
+		std::filesystem::path FileName;
+		if (SUCCEEDED(SHGetKnownFolderPath(FOLDERID_LocalAppData, 0, nullptr, &Folder)))
+		{
+			FileName = std::filesystem::path(Folder) / L"sysmgr" / L"classifier.cache";
+		}
+		CoTaskMemFree(Folder);
+		return FileName;
+	}
 };
 
 _Use_decl_annotations_
@@ -16,6 +16,8 @@
 #pragma comment(lib,"shcore")
 
 #include "resources/resources.hpp"
+#include "folders.hpp"
+#include "classifier.hpp"
 
 #pragma comment(linker, "\"/manifestdependency:type='win32' name='Microsoft.Windows.Common-Controls' version='6.0.0.0' processorArchitecture='*' publicKeyToken='6595b64144ccf1df' language='*'\"")
 